@@ -36,6 +36,12 @@
 #define THUMB_MOVE_TIMEOUT ms2us(300)
 #define FAKE_FINGER_OVERFLOW (1 << 7)
 
+#if HAVE_FIXED_POINT_ACCEL
+#define create_touchpad_filter create_pointer_accelerator_filter_touchpad_fixed
+#else
+#define create_touchpad_filter create_pointer_accelerator_filter_touchpad
+#endif
+
 static inline int
 tp_hysteresis(int in, int center, int margin)
 {
@@ -67,8 +73,7 @@ tp_filter_motion(struct tp_dispatch *tp,
 	if (normalized_is_zero(*unaccelerated))
 		return *unaccelerated;
 
-	return filter_dispatch(tp->device->pointer.filter,
-			       unaccelerated, tp, time);
+	return evdev_filter_dispatch(tp->device, unaccelerated, tp, time);
 }
 
 struct normalized_coords
@@ -1631,7 +1636,7 @@ tp_init_accel(struct tp_dispatch *tp, double diagonal)
 	    tp->device->model_flags & EVDEV_MODEL_LENOVO_X220_TOUCHPAD_FW81)
 		filter = create_pointer_accelerator_filter_lenovo_x230(tp->device->dpi);
 	else
-		filter = create_pointer_accelerator_filter_touchpad(tp->device->dpi);
+		filter = create_touchpad_filter(tp->device->dpi);
 
 	if (!filter)
 		return -1;
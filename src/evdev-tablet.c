@@ -343,7 +343,7 @@ tablet_handle_xy(struct tablet_dispatch *tablet,
 
 static inline struct normalized_coords
 tablet_process_delta(struct tablet_dispatch *tablet,
-		     const struct evdev_device *device,
+		     struct evdev_device *device,
 		     const struct device_coords *delta,
 		     uint64_t time)
 {
@@ -356,8 +356,7 @@ tablet_process_delta(struct tablet_dispatch *tablet,
 	if (normalized_is_zero(accel))
 		return accel;
 
-	return filter_dispatch(device->pointer.filter,
-			       &accel, tablet, time);
+	return evdev_filter_dispatch(device, &accel, tablet, time);
 }
 
 static inline double
@@ -713,22 +712,19 @@ tool_set_bits_from_libwacom(const struct tablet_dispatch *tablet,
 	int rc = 1;
 
 #if HAVE_LIBWACOM
-	struct libinput *libinput = tablet->device->base.seat->libinput;
-	WacomDeviceDatabase *db;
+	WacomDeviceDatabase *db =
+		libinput_libwacom_get_db(tablet->device->base.seat->libinput);
 	const WacomStylus *s = NULL;
 	int code;
 	WacomStylusType type;
 	WacomAxisTypeFlags axes;
 
-	db = libwacom_database_new();
-	if (!db) {
-		log_info(libinput,
-			 "Failed to initialize libwacom context.\n");
-		goto out;
-	}
+	if (!db)
+		return rc;
+
 	s = libwacom_stylus_get_for_id(db, tool->tool_id);
 	if (!s)
-		goto out;
+		return rc;
 
 	type = libwacom_stylus_get_type(s);
 	if (type == WSTYLUS_PUCK) {
@@ -772,9 +768,6 @@ tool_set_bits_from_libwacom(const struct tablet_dispatch *tablet,
 		copy_axis_cap(tablet, tool, LIBINPUT_TABLET_TOOL_AXIS_PRESSURE);
 
 	rc = 0;
-out:
-	if (db)
-		libwacom_database_destroy(db);
 #endif
 	return rc;
 }
@@ -854,33 +847,20 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 		uint32_t tool_id,
 		uint32_t serial)
 {
-	struct libinput_tablet_tool *tool = NULL, *t;
-	struct list *tool_list;
+	struct libinput *libinput = tablet->device->base.seat->libinput;
+	struct libinput_tablet_tool *tool;
 
-	if (serial) {
-		tool_list = &tablet->device->base.seat->libinput->tool_list;
+	if ((unsigned int)type > LIBINPUT_TABLET_TOOL_TYPE_MAX)
+		return NULL;
 
-		/* Check if we already have the tool in our list of tools */
-		list_for_each(t, tool_list, link) {
-			if (type == t->type && serial == t->serial) {
-				tool = t;
-				break;
-			}
-		}
+	if (serial) {
+		tool = libinput_tablet_tool_find(libinput, type, serial);
 	} else {
 		/* We can't guarantee that tools without serial numbers are
 		 * unique, so we keep them local to the tablet that they come
 		 * into proximity of instead of storing them in the global tool
-		 * list */
-		tool_list = &tablet->tool_list;
-
-		/* Same as above, but don't bother checking the serial number */
-		list_for_each(t, tool_list, link) {
-			if (type == t->type) {
-				tool = t;
-				break;
-			}
-		}
+		 * table */
+		tool = tablet->tools[type];
 	}
 
 	/* If we didn't already have the new_tool in our list of tools,
@@ -917,7 +897,16 @@ tablet_get_tool(struct tablet_dispatch *tablet,
 
 		tool_set_bits(tablet, tool);
 
-		list_insert(tool_list, &tool->link);
+		if (serial) {
+			if (libinput_tablet_tool_add(libinput, tool) != 0) {
+				free(tool);
+				return NULL;
+			}
+		} else {
+			/* not in any list, but unref removes it from one */
+			list_init(&tool->link);
+			tablet->tools[type] = tool;
+		}
 	}
 
 	return tool;
@@ -1424,10 +1413,11 @@ tablet_destroy(struct evdev_dispatch *dispatch)
 {
 	struct tablet_dispatch *tablet =
 		(struct tablet_dispatch*)dispatch;
-	struct libinput_tablet_tool *tool, *tmp;
+	size_t i;
 
-	list_for_each_safe(tool, tmp, &tablet->tool_list, link) {
-		libinput_tablet_tool_unref(tool);
+	for (i = 0; i < ARRAY_LENGTH(tablet->tools); i++) {
+		if (tablet->tools[i])
+			libinput_tablet_tool_unref(tablet->tools[i]);
 	}
 
 	free(tablet);
@@ -1573,17 +1563,14 @@ tablet_init_left_handed(struct evdev_device *device)
 {
 #if HAVE_LIBWACOM
 	struct libinput *libinput = device->base.seat->libinput;
-	WacomDeviceDatabase *db;
+	WacomDeviceDatabase *db = libinput_libwacom_get_db(libinput);
 	WacomDevice *d = NULL;
 	WacomError *error;
 	const char *devnode;
 
-	db = libwacom_database_new();
-	if (!db) {
-		log_info(libinput,
-			 "Failed to initialize libwacom context.\n");
+	if (!db)
 		return;
-	}
+
 	error = libwacom_error_new();
 	devnode = udev_device_get_devnode(device->udev_device);
 
@@ -1608,7 +1595,6 @@ tablet_init_left_handed(struct evdev_device *device)
 		libwacom_error_free(&error);
 	if (d)
 		libwacom_destroy(d);
-	libwacom_database_destroy(db);
 #endif
 }
 
@@ -1623,7 +1609,6 @@ tablet_init(struct tablet_dispatch *tablet,
 	tablet->device = device;
 	tablet->status = TABLET_NONE;
 	tablet->current_tool_type = LIBINPUT_TOOL_NONE;
-	list_init(&tablet->tool_list);
 
 	tablet_init_calibration(tablet, device);
 	tablet_init_proximity_threshold(tablet, device);
@@ -56,8 +56,9 @@ struct tablet_dispatch {
 	struct tablet_axes axes;
 	unsigned char axis_caps[NCHARS(LIBINPUT_TABLET_TOOL_AXIS_MAX + 1)];
 
-	/* Only used for tablets that don't report serial numbers */
-	struct list tool_list;
+	/* Only used for tablets that don't report serial numbers. Tools
+	 * without a serial are told apart by type only. */
+	struct libinput_tablet_tool *tools[LIBINPUT_TABLET_TOOL_TYPE_MAX + 1];
 
 	struct button_state button_state;
 	struct button_state prev_button_state;
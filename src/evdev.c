@@ -46,6 +46,15 @@
 #define DEFAULT_WHEEL_CLICK_ANGLE 15
 #define DEFAULT_MIDDLE_BUTTON_SCROLL_TIMEOUT ms2us(200)
 
+/* the fixed-point filters replace the linear and trackpoint filters */
+#if HAVE_FIXED_POINT_ACCEL
+#define create_linear_filter create_pointer_accelerator_filter_linear_fixed
+#define create_trackpoint_filter create_pointer_accelerator_filter_trackpoint_fixed
+#else
+#define create_linear_filter create_pointer_accelerator_filter_linear
+#define create_trackpoint_filter create_pointer_accelerator_filter_trackpoint
+#endif
+
 enum evdev_key_type {
 	EVDEV_KEY_TYPE_NONE,
 	EVDEV_KEY_TYPE_KEY,
@@ -317,10 +326,10 @@ evdev_flush_pending_event(struct evdev_device *device, uint64_t time)
 
 		if (device->pointer.filter) {
 			/* Apply pointer acceleration. */
-			accel = filter_dispatch(device->pointer.filter,
-						&unaccel,
-						device,
-						time);
+			accel = evdev_filter_dispatch(device,
+						      &unaccel,
+						      device,
+						      time);
 		} else {
 			log_bug_libinput(libinput,
 					 "%s: accel filter missing\n",
@@ -1330,7 +1339,7 @@ static inline void
 evdev_process_event(struct evdev_device *device, struct input_event *e)
 {
 	struct evdev_dispatch *dispatch = device->dispatch;
-	uint64_t time = s2us(e->time.tv_sec) + e->time.tv_usec;
+	uint64_t time = evdev_event_time(e);
 
 #if 0
 	if (libevdev_event_is_code(e, EV_SYN, SYN_REPORT))
@@ -1352,6 +1361,9 @@ static inline void
 evdev_device_dispatch_one(struct evdev_device *device,
 			  struct input_event *ev)
 {
+	if (libevdev_event_is_code(ev, EV_SYN, SYN_REPORT))
+		counter_inc(device->base.counters.syn_report);
+
 	if (!device->mtdev) {
 		evdev_process_event(device, ev);
 	} else {
@@ -1366,12 +1378,54 @@ evdev_device_dispatch_one(struct evdev_device *device,
 	}
 }
 
+/* Process a batch of events, usually one frame terminated by a
+ * SYN_REPORT. A frame split across two reads is passed in two batches.
+ * mtdev converts the events one frame at a time. */
+static void
+evdev_device_dispatch_batch(struct evdev_device *device,
+			    struct input_event *events,
+			    size_t nevents)
+{
+	size_t i;
+
+	if (nevents == 0)
+		return;
+
+	if (libevdev_event_is_code(&events[nevents - 1], EV_SYN, SYN_REPORT))
+		counter_inc(device->base.counters.syn_report);
+
+	if (device->mtdev) {
+		for (i = 0; i < nevents; i++) {
+			mtdev_put_event(device->mtdev, &events[i]);
+			if (!libevdev_event_is_code(&events[i],
+						    EV_SYN,
+						    SYN_REPORT))
+				continue;
+
+			while (!mtdev_empty(device->mtdev)) {
+				struct input_event e;
+				mtdev_get_event(device->mtdev, &e);
+				evdev_process_event(device, &e);
+			}
+		}
+	} else {
+		for (i = 0; i < nevents; i++)
+			evdev_process_event(device, &events[i]);
+	}
+}
+
 static int
 evdev_sync_device(struct evdev_device *device)
 {
 	struct input_event ev;
 	int rc;
 
+	/* libevdev discards whatever is left in the kernel buffer and
+	 * generates events for the differences between its state and the
+	 * current device state */
+	libevdev_next_event(device->evdev,
+			    LIBEVDEV_READ_FLAG_FORCE_SYNC, &ev);
+
 	do {
 		rc = libevdev_next_event(device->evdev,
 					 LIBEVDEV_READ_FLAG_SYNC, &ev);
@@ -1380,24 +1434,81 @@ evdev_sync_device(struct evdev_device *device)
 		evdev_device_dispatch_one(device, &ev);
 	} while (rc == LIBEVDEV_READ_STATUS_SYNC);
 
+	/* libevdev's current slot is valid again */
+	device->read_buffer.discard_mt = false;
+
 	return rc == -EAGAIN ? 0 : rc;
 }
 
-static void
-evdev_device_dispatch(void *data)
+/* We read events from the fd directly rather than through
+ * libevdev_next_event() but libevdev's view of the device state is still
+ * used (e.g. for touchpad slot values and to sync after SYN_DROPPED), so
+ * keep it up-to-date. Returns false if the event is to be discarded,
+ * e.g. because the event code was disabled.
+ *
+ * libevdev refuses an out-of-range ABS_MT_SLOT. The ABS_MT_* events that
+ * follow it address that slot and would otherwise be applied to the
+ * previous one, so they are discarded until a valid slot is selected. */
+static inline bool
+evdev_update_libevdev_state(struct evdev_device *device,
+			    const struct input_event *e)
+{
+	switch (e->type) {
+	case EV_SYN:
+		return true;
+	case EV_ABS:
+		if (e->code == ABS_MT_SLOT) {
+			device->read_buffer.discard_mt =
+				libevdev_set_event_value(device->evdev,
+							 e->type,
+							 e->code,
+							 e->value) != 0;
+			return !device->read_buffer.discard_mt;
+		}
+
+		if (device->read_buffer.discard_mt &&
+		    e->code > ABS_MT_SLOT &&
+		    e->code <= ABS_MT_TOOL_Y)
+			return false;
+		/* fallthrough */
+	case EV_KEY:
+	case EV_LED:
+	case EV_SW:
+		return libevdev_set_event_value(device->evdev,
+						e->type,
+						e->code,
+						e->value) == 0;
+	default:
+		return libevdev_has_event_code(device->evdev,
+					       e->type,
+					       e->code);
+	}
+}
+
+/* Process the events in the read buffer until it is empty or the
+ * dispatch budget is exhausted at a frame boundary. If one_frame is set,
+ * stop after the first SYN_REPORT instead, the caller does the budget
+ * accounting. Returns 0 on success or a negative errno if the device
+ * could not be synced after a SYN_DROPPED. */
+static int
+evdev_device_process_read_buffer(struct evdev_device *device,
+				 bool one_frame)
 {
-	struct evdev_device *device = data;
 	struct libinput *libinput = device->base.seat->libinput;
-	struct input_event ev;
-	int rc;
+	struct input_event *ev, *batch = NULL;
+	size_t nbatch = 0;
 
-	/* If the compositor is repainting, this function is called only once
-	 * per frame and we have to process all the events available on the
-	 * fd, otherwise there will be input lag. */
-	do {
-		rc = libevdev_next_event(device->evdev,
-					 LIBEVDEV_READ_FLAG_NORMAL, &ev);
-		if (rc == LIBEVDEV_READ_STATUS_SYNC) {
+	while (device->read_buffer.next < device->read_buffer.count) {
+		if (!one_frame &&
+		    !device->read_buffer.in_frame &&
+		    libinput_dispatch_budget_exhausted(libinput))
+			break;
+
+		ev = &device->read_buffer.events[device->read_buffer.next++];
+		libinput_dispatch_budget_consume(libinput);
+
+		if (libevdev_event_is_code(ev, EV_SYN, SYN_DROPPED)) {
+			counter_inc(device->base.counters.syn_dropped);
 			log_info_ratelimit(libinput,
 					   &device->syn_drop_limit,
 					   "SYN_DROPPED event from \"%s\" - some input events have been lost.\n",
@@ -1405,38 +1516,201 @@ evdev_device_dispatch(void *data)
 
 			/* send one more sync event so we handle all
 			   currently pending events before we sync up
-			   to the current state */
-			ev.code = SYN_REPORT;
-			evdev_device_dispatch_one(device, &ev);
-
-			rc = evdev_sync_device(device);
-			if (rc == 0)
-				rc = LIBEVDEV_READ_STATUS_SUCCESS;
-		} else if (rc == LIBEVDEV_READ_STATUS_SUCCESS) {
-			evdev_device_dispatch_one(device, &ev);
+			   to the current state. The rest of the
+			   buffer is stale, the sync replaces it. */
+			ev->code = SYN_REPORT;
+			if (!batch)
+				batch = ev;
+			batch[nbatch++] = *ev;
+			evdev_device_dispatch_batch(device, batch, nbatch);
+
+			device->read_buffer.count = 0;
+			device->read_buffer.next = 0;
+			device->read_buffer.in_frame = false;
+
+			return evdev_sync_device(device);
 		}
-	} while (rc == LIBEVDEV_READ_STATUS_SUCCESS);
 
-	if (rc != -EAGAIN && rc != -EINTR) {
+		if (!evdev_update_libevdev_state(device, ev))
+			continue;
+
+		/* Discarded events are squeezed out of the batch, the
+		 * slots before next were processed already */
+		if (!batch)
+			batch = ev;
+		batch[nbatch++] = *ev;
+
+		device->read_buffer.in_frame =
+			!libevdev_event_is_code(ev, EV_SYN, SYN_REPORT);
+		if (!device->read_buffer.in_frame) {
+			evdev_device_dispatch_batch(device, batch, nbatch);
+			batch = NULL;
+			nbatch = 0;
+			if (one_frame)
+				break;
+		}
+	}
+
+	/* The rest of the frame is in the next read */
+	evdev_device_dispatch_batch(device, batch, nbatch);
+
+	return 0;
+}
+
+/* Refill the empty read buffer from the fd. Returns the number of events
+ * read or a negative errno. */
+static int
+evdev_device_read(struct evdev_device *device)
+{
+	size_t nevents;
+	ssize_t len;
+
+	len = libinput_source_read(device->base.seat->libinput,
+				   device->source);
+	if (len < 0)
+		return len;
+	else if (len % sizeof(device->read_buffer.events[0]) != 0)
+		return -EINVAL;
+
+	nevents = len / sizeof(device->read_buffer.events[0]);
+	counter_add(device->base.counters.evdev_events, nevents);
+
+	device->read_buffer.count = nevents;
+	device->read_buffer.next = 0;
+
+	return nevents;
+}
+
+/* Remove the device's source on a read error, otherwise mark it pending
+ * if unprocessed events are left in the read buffer */
+static void
+evdev_device_dispatch_done(struct evdev_device *device, int rc)
+{
+	struct libinput *libinput = device->base.seat->libinput;
+
+	if (rc < 0 && rc != -EAGAIN && rc != -EINTR) {
 		libinput_remove_source(libinput, device->source);
 		device->source = NULL;
+		return;
 	}
+
+	libinput_source_set_pending(libinput,
+				    device->source,
+				    device->read_buffer.next <
+				    device->read_buffer.count);
 }
 
+static void
+evdev_device_dispatch(void *data)
+{
+	struct evdev_device *device = data;
+	struct libinput *libinput = device->base.seat->libinput;
+	size_t nevents;
+	int rc;
+
+	/* Events left over from a budgeted dispatch go first */
+	rc = evdev_device_process_read_buffer(device, false);
+
+	/* If the compositor is repainting, this function is called only once
+	 * per frame and we have to process all the events available on the
+	 * fd, otherwise there will be input lag. A short read means the
+	 * kernel buffer is empty, anything arriving later wakes us up
+	 * again. A frame split across two reads is always completed,
+	 * regardless of the budget. */
+	while (rc == 0 &&
+	       device->read_buffer.next == device->read_buffer.count) {
+		if (!device->read_buffer.in_frame &&
+		    libinput_dispatch_budget_exhausted(libinput))
+			break;
+
+		rc = evdev_device_read(device);
+		if (rc < 0)
+			break;
+
+		nevents = rc;
+		rc = evdev_device_process_read_buffer(device, false);
+		if (nevents < ARRAY_LENGTH(device->read_buffer.events))
+			break;
+	}
+
+	evdev_device_dispatch_done(device, rc);
+}
+
+static bool
+evdev_device_peek_frame(void *data, uint64_t *time)
+{
+	struct evdev_device *device = data;
+	struct input_event *ev;
+	int rc;
+
+	if (device->read_buffer.next == device->read_buffer.count) {
+		rc = evdev_device_read(device);
+		if (rc <= 0) {
+			evdev_device_dispatch_done(device, rc);
+			return false;
+		}
+	}
+
+	ev = &device->read_buffer.events[device->read_buffer.next];
+	*time = evdev_event_time(ev);
+
+	return true;
+}
+
+static void
+evdev_device_dispatch_frame(void *data)
+{
+	struct evdev_device *device = data;
+	int rc = 0;
+
+	do {
+		if (device->read_buffer.next == device->read_buffer.count) {
+			rc = evdev_device_read(device);
+			if (rc <= 0)
+				break;
+		}
+
+		rc = evdev_device_process_read_buffer(device, true);
+	} while (rc == 0 && device->read_buffer.in_frame);
+
+	evdev_device_dispatch_done(device, rc);
+}
+
+static bool
+evdev_device_is_priority(void *data)
+{
+	struct evdev_device *device = data;
+
+	return evdev_device_has_capability(device,
+					   LIBINPUT_DEVICE_CAP_KEYBOARD);
+}
+
+static const struct libinput_source_frame_interface evdev_frame_interface = {
+	.peek_frame = evdev_device_peek_frame,
+	.dispatch_frame = evdev_device_dispatch_frame,
+	.is_priority = evdev_device_is_priority,
+};
+
 static inline int
 evdev_init_accel(struct evdev_device *device,
 		 enum libinput_config_accel_profile which)
 {
 	struct motion_filter *filter;
 
-	if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
+	if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		filter = create_pointer_accelerator_filter_custom(
+					device->dpi,
+					device->pointer.custom.velocities,
+					device->pointer.custom.factors,
+					device->pointer.custom.npoints);
+	else if (which == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT)
 		filter = create_pointer_accelerator_filter_flat(device->dpi);
 	else if (device->tags & EVDEV_TAG_TRACKPOINT)
-		filter = create_pointer_accelerator_filter_trackpoint(device->dpi);
+		filter = create_trackpoint_filter(device->dpi);
 	else if (device->dpi < DEFAULT_MOUSE_DPI)
 		filter = create_pointer_accelerator_filter_linear_low_dpi(device->dpi);
 	else
-		filter = create_pointer_accelerator_filter_linear(device->dpi);
+		filter = create_linear_filter(device->dpi);
 
 	if (!filter)
 		return -1;
@@ -1486,30 +1760,64 @@ evdev_accel_config_get_profiles(struct libinput_device *libinput_device)
 		return LIBINPUT_CONFIG_ACCEL_PROFILE_NONE;
 
 	return LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE |
-		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT;
+		LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT |
+		LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM;
 }
 
-static enum libinput_config_status
-evdev_accel_config_set_profile(struct libinput_device *libinput_device,
-			       enum libinput_config_accel_profile profile)
+static void
+evdev_accel_reinit(struct evdev_device *device,
+		   enum libinput_config_accel_profile profile)
 {
-	struct evdev_device *device = (struct evdev_device*)libinput_device;
 	struct motion_filter *filter;
 	double speed;
 
 	filter = device->pointer.filter;
-	if (filter_get_type(filter) == profile)
-		return LIBINPUT_CONFIG_STATUS_SUCCESS;
-
 	speed = filter_get_speed(filter);
 	device->pointer.filter = NULL;
 
 	if (evdev_init_accel(device, profile) == 0) {
-		evdev_accel_config_set_speed(libinput_device, speed);
+		evdev_accel_config_set_speed(&device->base, speed);
 		filter_destroy(filter);
 	} else {
 		device->pointer.filter = filter;
 	}
+}
+
+static enum libinput_config_status
+evdev_accel_config_set_profile(struct libinput_device *libinput_device,
+			       enum libinput_config_accel_profile profile)
+{
+	struct evdev_device *device = (struct evdev_device*)libinput_device;
+
+	if (filter_get_type(device->pointer.filter) == profile)
+		return LIBINPUT_CONFIG_STATUS_SUCCESS;
+
+	evdev_accel_reinit(device, profile);
+
+	return LIBINPUT_CONFIG_STATUS_SUCCESS;
+}
+
+static enum libinput_config_status
+evdev_accel_config_set_custom_points(struct libinput_device *libinput_device,
+				     const double *velocities,
+				     const double *factors,
+				     size_t npoints)
+{
+	struct evdev_device *device = (struct evdev_device*)libinput_device;
+
+	memcpy(device->pointer.custom.velocities,
+	       velocities,
+	       npoints * sizeof(*velocities));
+	memcpy(device->pointer.custom.factors,
+	       factors,
+	       npoints * sizeof(*factors));
+	device->pointer.custom.npoints = npoints;
+
+	/* the curve is compiled into the filter, so the filter needs to be
+	 * replaced if the custom profile is already in use */
+	if (filter_get_type(device->pointer.filter) ==
+	    LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM)
+		evdev_accel_reinit(device, LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
 
 	return LIBINPUT_CONFIG_STATUS_SUCCESS;
 }
@@ -1539,6 +1847,7 @@ evdev_device_init_pointer_acceleration(struct evdev_device *device,
 				       struct motion_filter *filter)
 {
 	device->pointer.filter = filter;
+	device->pointer.dispatch = filter_get_dispatch_type(filter);
 
 	if (device->base.config.accel == NULL) {
 		device->pointer.config.available = evdev_accel_config_available;
@@ -1549,8 +1858,14 @@ evdev_device_init_pointer_acceleration(struct evdev_device *device,
 		device->pointer.config.set_profile = evdev_accel_config_set_profile;
 		device->pointer.config.get_profile = evdev_accel_config_get_profile;
 		device->pointer.config.get_default_profile = evdev_accel_config_get_default_profile;
+		device->pointer.config.set_custom_points = evdev_accel_config_set_custom_points;
 		device->base.config.accel = &device->pointer.config;
 
+		/* custom profile defaults to a constant factor of 1 */
+		device->pointer.custom.velocities[0] = 0.0;
+		device->pointer.custom.factors[0] = 1.0;
+		device->pointer.custom.npoints = 1;
+
 		evdev_accel_config_set_speed(&device->base,
 			     evdev_accel_config_get_default_speed(&device->base));
 	}
@@ -2371,9 +2686,16 @@ evdev_device_create(struct libinput_seat *seat,
 		goto err;
 
 	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+		libinput_add_fd_read(libinput,
+				     fd,
+				     device->read_buffer.events,
+				     sizeof(device->read_buffer.events),
+				     evdev_device_dispatch,
+				     device);
 	if (!device->source)
 		goto err;
+	libinput_source_set_frame_interface(device->source,
+					    &evdev_frame_interface);
 
 	if (evdev_set_device_group(device, udev_device))
 		goto err;
@@ -2731,6 +3053,10 @@ evdev_device_suspend(struct evdev_device *device)
 		device->source = NULL;
 	}
 
+	device->read_buffer.count = 0;
+	device->read_buffer.next = 0;
+	device->read_buffer.in_frame = false;
+
 	if (device->mtdev) {
 		mtdev_close_delete(device->mtdev);
 		device->mtdev = NULL;
@@ -2796,11 +3122,18 @@ evdev_device_resume(struct evdev_device *device)
 	} while (status == LIBEVDEV_READ_STATUS_SYNC);
 
 	device->source =
-		libinput_add_fd(libinput, fd, evdev_device_dispatch, device);
+		libinput_add_fd_read(libinput,
+				     fd,
+				     device->read_buffer.events,
+				     sizeof(device->read_buffer.events),
+				     evdev_device_dispatch,
+				     device);
 	if (!device->source) {
 		mtdev_close_delete(device->mtdev);
 		return -ENOMEM;
 	}
+	libinput_source_set_frame_interface(device->source,
+					    &evdev_frame_interface);
 
 	memset(device->hw_key_mask, 0, sizeof(device->hw_key_mask));
 
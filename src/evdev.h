@@ -45,6 +45,9 @@
 /* The fake resolution value for abs devices without resolution */
 #define EVDEV_FAKE_RESOLUTION 1
 
+/* Number of input events read from the fd at once */
+#define EVDEV_READ_BUFFER_SIZE 64
+
 enum evdev_event_type {
 	EVDEV_NONE,
 	EVDEV_ABSOLUTE_TOUCH_DOWN,
@@ -195,6 +198,16 @@ struct evdev_device {
 	struct {
 		struct libinput_device_config_accel config;
 		struct motion_filter *filter;
+		/* cached filter_get_dispatch_type() */
+		enum filter_dispatch_type dispatch;
+
+		/* curve for LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM,
+		 * velocities in units/ms */
+		struct {
+			double velocities[ACCEL_CUSTOM_MAX_POINTS];
+			double factors[ACCEL_CUSTOM_MAX_POINTS];
+			size_t npoints;
+		} custom;
 	} pointer;
 
 	/* Bitmask of pressed keys used to ignore initial release events from
@@ -228,6 +241,16 @@ struct evdev_device {
 	} middlebutton;
 
 	int dpi; /* HW resolution */
+	/* Events read from the fd but not yet processed because the
+	 * dispatch budget ran out, see libinput_dispatch_budget() */
+	struct {
+		struct input_event events[EVDEV_READ_BUFFER_SIZE];
+		size_t count;
+		size_t next;
+		bool in_frame; /* last processed event was not a SYN_REPORT */
+		bool discard_mt; /* ABS_MT_* events address a refused slot */
+	} read_buffer;
+
 	struct ratelimit syn_drop_limit; /* ratelimit for SYN_DROPPED logging */
 	struct ratelimit nonpointer_rel_limit; /* ratelimit for REL_* events from non-pointer devices */
 
@@ -442,6 +465,37 @@ evdev_init_middlebutton(struct evdev_device *device,
 			bool enabled,
 			bool want_config);
 
+/* filter_dispatch() on the device's filter, using the specialized
+ * dispatch function where one exists */
+static inline struct normalized_coords
+evdev_filter_dispatch(struct evdev_device *device,
+		      const struct normalized_coords *unaccelerated,
+		      void *data, uint64_t time)
+{
+	struct motion_filter *filter = device->pointer.filter;
+
+	counter_inc(device->base.counters.filter_dispatch);
+
+	switch (device->pointer.dispatch) {
+	case FILTER_DISPATCH_LINEAR:
+		return filter_dispatch_linear(filter, unaccelerated,
+					      data, time);
+	case FILTER_DISPATCH_TOUCHPAD:
+		return filter_dispatch_touchpad(filter, unaccelerated,
+						data, time);
+	case FILTER_DISPATCH_GENERIC:
+		break;
+	}
+
+	return filter_dispatch(filter, unaccelerated, data, time);
+}
+
+static inline uint64_t
+evdev_event_time(const struct input_event *e)
+{
+	return s2us(e->time.tv_sec) + e->time.tv_usec;
+}
+
 static inline double
 evdev_convert_to_mm(const struct input_absinfo *absinfo, double v)
 {
@@ -34,6 +34,13 @@ struct motion_filter_interface {
 			   struct motion_filter *filter,
 			   const struct normalized_coords *unaccelerated,
 			   void *data, uint64_t time);
+	/* optional, see filter_dispatch_batch() */
+	void (*filter_batch)(struct motion_filter *filter,
+			     const struct normalized_coords *unaccelerated,
+			     struct normalized_coords *accelerated,
+			     const uint64_t *time,
+			     size_t ndeltas,
+			     void *data);
 	struct normalized_coords (*filter_constant)(
 			   struct motion_filter *filter,
 			   const struct normalized_coords *unaccelerated,
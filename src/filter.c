@@ -64,6 +64,33 @@ filter_dispatch(struct motion_filter *filter,
 	return filter->interface->filter(filter, unaccelerated, data, time);
 }
 
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct normalized_coords *unaccelerated,
+		      struct normalized_coords *accelerated,
+		      const uint64_t *time,
+		      size_t ndeltas,
+		      void *data)
+{
+	size_t i;
+
+	if (filter->interface->filter_batch) {
+		filter->interface->filter_batch(filter,
+						unaccelerated,
+						accelerated,
+						time,
+						ndeltas,
+						data);
+		return;
+	}
+
+	for (i = 0; i < ndeltas; i++)
+		accelerated[i] = filter->interface->filter(filter,
+							   &unaccelerated[i],
+							   data,
+							   time[i]);
+}
+
 struct normalized_coords
 filter_dispatch_constant(struct motion_filter *filter,
 			 const struct normalized_coords *unaccelerated,
@@ -130,12 +157,49 @@ filter_get_type(struct motion_filter *filter)
 
 #define MAX_VELOCITY_DIFF	v_ms2us(1) /* units/us */
 #define MOTION_TIMEOUT		ms2us(1000)
-#define NUM_POINTER_TRACKERS	16
+#define NUM_POINTER_TRACKERS	16 /* must be a power of two */
+#define TRACKER_REBASE_LIMIT	1e6 /* units */
+
+/* For devices with a high report rate, several events are merged into
+ * one tracker so the trackers cover roughly the same time span as they
+ * do on a 1000Hz device. */
+#define TRACKER_MIN_INTERVAL	ms2us(1) /* us */
+#define REPORT_INTERVAL_MAX	ms2us(100) /* us, longer is a pause */
+#define REPORT_INTERVAL_SHIFT	16 /* fractional bits of the interval */
+
+/* The acceleration profiles are sampled into a lookup table, velocities
+ * above the table's range use the profile directly. All profiles are
+ * flat well below the maximum velocity. */
+#define ACCEL_LUT_SIZE		1024
+#define ACCEL_LUT_MAX_VELOCITY	v_ms2us(5.0) /* units/us */
+
+/* Time and direction of the trackers, shared by the floating point and
+ * the fixed-point accelerator. Those keep the running sums in their own
+ * arithmetic, indexed like the ring. */
+struct tracker_ring {
+	uint64_t time[NUM_POINTER_TRACKERS]; /* us */
+	int dir[NUM_POINTER_TRACKERS];
+	int cur;		/* index of the current tracker */
+	int nevents;		/* events merged into the current tracker */
+
+	uint64_t report_interval; /* us << REPORT_INTERVAL_SHIFT, average */
+	uint64_t last_time;	/* us */
+};
 
+/* The delta from a tracker to the most recent event is the difference
+ * between the accelerator's running sum of all deltas and the running sum
+ * when the tracker was created, so feeding a new delta only touches one
+ * tracker */
 struct pointer_tracker {
-	struct normalized_coords delta; /* delta to most recent event */
-	uint64_t time;  /* us */
-	int dir;
+	struct normalized_coords origin; /* running sum at creation */
+	struct normalized_coords start; /* running sum before creation */
+};
+
+/* A piecewise linear curve for the custom profile */
+struct accel_curve {
+	double velocity[ACCEL_CUSTOM_MAX_POINTS]; /* units/us */
+	double factor[ACCEL_CUSTOM_MAX_POINTS];	/* unitless */
+	size_t npoints;
 };
 
 struct pointer_accelerator {
@@ -146,14 +210,24 @@ struct pointer_accelerator {
 	double velocity;	/* units/us */
 	double last_velocity;	/* units/us */
 
+	struct tracker_ring ring;
 	struct pointer_tracker *trackers;
-	int cur_tracker;
+	struct normalized_coords delta_sum; /* running sum of all deltas */
 
 	double threshold;	/* units/us */
 	double accel;		/* unitless factor */
 	double incline;		/* incline of the function */
 
 	double dpi_factor;
+
+	/* only for the custom profile */
+	struct accel_curve *curve;
+
+	/* profile sampled at lut_max_velocity/ACCEL_LUT_SIZE intervals,
+	 * the last entry is at lut_max_velocity */
+	double lut[ACCEL_LUT_SIZE + 1];
+	double lut_max_velocity;	/* units/us */
+	double lut_scale;		/* ACCEL_LUT_SIZE/lut_max_velocity */
 };
 
 struct pointer_accelerator_flat {
@@ -170,47 +244,204 @@ struct tablet_accelerator_flat {
 	int xres, yres;
 };
 
+static inline unsigned int
+tracker_index(const struct tracker_ring *ring, unsigned int offset)
+{
+	return (ring->cur - offset) & (NUM_POINTER_TRACKERS - 1);
+}
+
 static void
-feed_trackers(struct pointer_accelerator *accel,
-	      const struct normalized_coords *delta,
-	      uint64_t time)
+tracker_ring_update_interval(struct tracker_ring *ring, uint64_t time)
+{
+	uint64_t interval;
+
+	if (ring->last_time != 0 && time > ring->last_time) {
+		interval = time - ring->last_time;
+
+		if (interval < REPORT_INTERVAL_MAX) {
+			interval <<= REPORT_INTERVAL_SHIFT;
+			if (ring->report_interval == 0)
+				ring->report_interval = interval;
+			else
+				ring->report_interval =
+					(7 * ring->report_interval +
+					 interval) / 8;
+		}
+	}
+
+	ring->last_time = time;
+}
+
+/* Number of events to merge into one tracker, rounded so that jitter
+ * around an exact multiple of the report rate doesn't change it */
+static inline int
+tracker_ring_stride(const struct tracker_ring *ring)
+{
+	uint64_t min_interval =
+		(uint64_t)TRACKER_MIN_INTERVAL << REPORT_INTERVAL_SHIFT;
+
+	if (ring->report_interval == 0)
+		return 1;
+
+	return max(1, (int)((min_interval + ring->report_interval / 2) /
+			    ring->report_interval));
+}
+
+/* Returns true if the event at time is merged into the current tracker,
+ * false if it starts a new one. The caller updates the current tracker's
+ * running sums and direction. */
+static bool
+tracker_ring_feed(struct tracker_ring *ring, uint64_t time)
 {
-	int i, current;
-	struct pointer_tracker *trackers = accel->trackers;
+	unsigned int current = tracker_index(ring, 0);
+
+	tracker_ring_update_interval(ring, time);
+
+	if (ring->nevents > 0 &&
+	    ring->nevents < tracker_ring_stride(ring) &&
+	    time - ring->time[current] < TRACKER_MIN_INTERVAL) {
+		ring->nevents++;
+		return true;
+	}
+
+	ring->cur = (ring->cur + 1) & (NUM_POINTER_TRACKERS - 1);
+	ring->time[ring->cur] = time;
+	ring->nevents = 1;
+
+	return false;
+}
+
+/* Returns the number of trackers, counting from offset 1, that are within
+ * the motion timeout and move in the direction of the current tracker.
+ * If that is zero, timed_out tells whether the tracker at offset 1 timed
+ * out or changed direction. */
+static unsigned int
+tracker_ring_count_valid(const struct tracker_ring *ring,
+			 uint64_t time,
+			 bool *timed_out)
+{
+	unsigned int dir = ring->dir[tracker_index(ring, 0)];
+	unsigned int offset, index;
+
+	*timed_out = false;
+
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		index = tracker_index(ring, offset);
+
+		/* Stop if too far away in time */
+		if (time - ring->time[index] > MOTION_TIMEOUT ||
+		    ring->time[index] > time) {
+			*timed_out = (offset == 1);
+			break;
+		}
+
+		/* Stop if direction changed */
+		dir &= ring->dir[index];
+		if (dir == 0)
+			break;
+	}
+
+	return offset - 1;
+}
+
+static void
+tracker_ring_restart(struct tracker_ring *ring, uint64_t time)
+{
+	int i;
 
 	for (i = 0; i < NUM_POINTER_TRACKERS; i++) {
-		trackers[i].delta.x += delta->x;
-		trackers[i].delta.y += delta->y;
+		ring->time[i] = 0;
+		ring->dir[i] = 0;
 	}
 
-	current = (accel->cur_tracker + 1) % NUM_POINTER_TRACKERS;
-	accel->cur_tracker = current;
+	ring->time[ring->cur] = time;
+	ring->dir[ring->cur] = UNDEFINED_DIRECTION;
 
-	trackers[current].delta.x = 0.0;
-	trackers[current].delta.y = 0.0;
-	trackers[current].time = time;
-	trackers[current].dir = normalized_get_direction(*delta);
+	/* the next event starts a new tracker */
+	ring->nevents = 0;
+}
+
+static void
+rebase_trackers(struct pointer_accelerator *accel)
+{
+	struct normalized_coords sum = accel->delta_sum;
+	int i;
+
+	/* Keep the running sum small enough that the difference of two
+	 * sums doesn't lose precision */
+	for (i = 0; i < NUM_POINTER_TRACKERS; i++) {
+		accel->trackers[i].origin.x -= sum.x;
+		accel->trackers[i].origin.y -= sum.y;
+		accel->trackers[i].start.x -= sum.x;
+		accel->trackers[i].start.y -= sum.y;
+	}
+
+	accel->delta_sum.x = 0.0;
+	accel->delta_sum.y = 0.0;
 }
 
 static struct pointer_tracker *
 tracker_by_offset(struct pointer_accelerator *accel, unsigned int offset)
 {
-	unsigned int index =
-		(accel->cur_tracker + NUM_POINTER_TRACKERS - offset)
-		% NUM_POINTER_TRACKERS;
-	return &accel->trackers[index];
+	return &accel->trackers[tracker_index(&accel->ring, offset)];
+}
+
+static void
+feed_trackers(struct pointer_accelerator *accel,
+	      const struct normalized_coords *delta,
+	      uint64_t time)
+{
+	struct pointer_tracker *tracker;
+	struct normalized_coords merged;
+	bool merge;
+
+	accel->delta_sum.x += delta->x;
+	accel->delta_sum.y += delta->y;
+
+	merge = tracker_ring_feed(&accel->ring, time);
+	tracker = tracker_by_offset(accel, 0);
+	if (!merge) {
+		tracker->origin = accel->delta_sum;
+		tracker->start.x = accel->delta_sum.x - delta->x;
+		tracker->start.y = accel->delta_sum.y - delta->y;
+	}
+
+	/* A merged tracker keeps its time, its origin and thus its delta is
+	 * the running sum after the first event in the tracker. The
+	 * direction is that of all events in the tracker combined. */
+	merged.x = accel->delta_sum.x - tracker->start.x;
+	merged.y = accel->delta_sum.y - tracker->start.y;
+	accel->ring.dir[accel->ring.cur] = normalized_get_direction(merged);
+
+	if (fabs(accel->delta_sum.x) > TRACKER_REBASE_LIMIT ||
+	    fabs(accel->delta_sum.y) > TRACKER_REBASE_LIMIT)
+		rebase_trackers(accel);
 }
 
 static double
-calculate_tracker_velocity(struct pointer_tracker *tracker, uint64_t time)
+calculate_tracker_velocity(struct pointer_accelerator *accel,
+			   unsigned int offset,
+			   uint64_t time)
 {
-	double tdelta = time - tracker->time + 1;
-	return normalized_length(tracker->delta) / tdelta; /* units/us */
+	struct pointer_tracker *tracker = tracker_by_offset(accel, offset);
+	struct normalized_coords delta;
+	uint64_t tracker_time =
+		accel->ring.time[tracker_index(&accel->ring, offset)];
+	double tdelta = time - tracker_time + 1;
+
+	delta.x = accel->delta_sum.x - tracker->origin.x;
+	delta.y = accel->delta_sum.y - tracker->origin.y;
+
+	return normalized_length(delta) / tdelta; /* units/us */
 }
 
 static inline double
-calculate_velocity_after_timeout(struct pointer_tracker *tracker)
+calculate_velocity_after_timeout(struct pointer_accelerator *accel,
+				 unsigned int offset)
 {
+	uint64_t tracker_time =
+		accel->ring.time[tracker_index(&accel->ring, offset)];
+
 	/* First movement after timeout needs special handling.
 	 *
 	 * When we trigger the timeout, the last event is too far in the
@@ -222,46 +453,35 @@ calculate_velocity_after_timeout(struct pointer_tracker *tracker)
 	 * for really slow movements but provides much more useful initial
 	 * movement in normal use-cases (pause, move, pause, move)
 	 */
-	return calculate_tracker_velocity(tracker,
-					  tracker->time + MOTION_TIMEOUT);
+	return calculate_tracker_velocity(accel,
+					  offset,
+					  tracker_time + MOTION_TIMEOUT);
 }
 
 static double
 calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 {
-	struct pointer_tracker *tracker;
 	double velocity;
 	double result = 0.0;
 	double initial_velocity = 0.0;
 	double velocity_diff;
-	unsigned int offset;
-
-	unsigned int dir = tracker_by_offset(accel, 0)->dir;
+	unsigned int offset, ntrackers;
+	bool timed_out;
 
 	/* Find least recent vector within a timelimit, maximum velocity diff
 	 * and direction threshold. */
-	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
-		tracker = tracker_by_offset(accel, offset);
-
-		/* Stop if too far away in time */
-		if (time - tracker->time > MOTION_TIMEOUT ||
-		    tracker->time > time) {
-			if (offset == 1)
-				result = calculate_velocity_after_timeout(tracker);
-			break;
-		}
+	ntrackers = tracker_ring_count_valid(&accel->ring, time, &timed_out);
+	if (ntrackers == 0) {
+		if (timed_out)
+			return calculate_velocity_after_timeout(accel, 1);
+
+		/* First movement after dirchange - velocity is that of the
+		 * last movement */
+		return calculate_tracker_velocity(accel, 1, time);
+	}
 
-		velocity = calculate_tracker_velocity(tracker, time);
-
-		/* Stop if direction changed */
-		dir &= tracker->dir;
-		if (dir == 0) {
-			/* First movement after dirchange - velocity is that
-			 * of the last movement */
-			if (offset == 1)
-				result = velocity;
-			break;
-		}
+	for (offset = 1; offset <= ntrackers; offset++) {
+		velocity = calculate_tracker_velocity(accel, offset, time);
 
 		if (initial_velocity == 0.0) {
 			result = initial_velocity = velocity;
@@ -278,15 +498,47 @@ calculate_velocity(struct pointer_accelerator *accel, uint64_t time)
 	return result; /* units/us */
 }
 
-static double
+/* Must be called whenever a parameter used by the profile changes */
+static void
+accelerator_update_lut(struct pointer_accelerator *accel)
+{
+	const double step = accel->lut_max_velocity/ACCEL_LUT_SIZE;
+	int i;
+
+	accel->lut_scale = ACCEL_LUT_SIZE/accel->lut_max_velocity;
+
+	/* None of the profiles use data or time */
+	for (i = 0; i <= ACCEL_LUT_SIZE; i++)
+		accel->lut[i] = accel->profile(&accel->base,
+					       NULL,
+					       i * step,
+					       0);
+}
+
+/* profile is always accel->profile, the specialized dispatch functions
+ * pass it in as a constant so the call can be inlined */
+static inline double
 acceleration_profile(struct pointer_accelerator *accel,
+		     accel_profile_func_t profile,
 		     void *data, double velocity, uint64_t time)
 {
-	return accel->profile(&accel->base, data, velocity, time);
+	double pos = velocity * accel->lut_scale;
+	double frac;
+	int idx;
+
+	if (pos >= ACCEL_LUT_SIZE)
+		return profile(&accel->base, data, velocity, time);
+
+	/* linear interpolation between the two closest samples */
+	idx = (int)pos;
+	frac = pos - idx;
+
+	return accel->lut[idx] + (accel->lut[idx + 1] - accel->lut[idx]) * frac;
 }
 
-static double
+static inline double
 calculate_acceleration(struct pointer_accelerator *accel,
+		       accel_profile_func_t profile,
 		       void *data,
 		       double velocity,
 		       double last_velocity,
@@ -296,10 +548,11 @@ calculate_acceleration(struct pointer_accelerator *accel,
 
 	/* Use Simpson's rule to calculate the avarage acceleration between
 	 * the previous motion and the most recent. */
-	factor = acceleration_profile(accel, data, velocity, time);
-	factor += acceleration_profile(accel, data, last_velocity, time);
+	factor = acceleration_profile(accel, profile, data, velocity, time);
+	factor += acceleration_profile(accel, profile, data,
+				       last_velocity, time);
 	factor += 4.0 *
-		acceleration_profile(accel, data,
+		acceleration_profile(accel, profile, data,
 				     (last_velocity + velocity) / 2,
 				     time);
 
@@ -310,6 +563,7 @@ calculate_acceleration(struct pointer_accelerator *accel,
 
 static inline double
 calculate_acceleration_factor(struct pointer_accelerator *accel,
+			      accel_profile_func_t profile,
 			      const struct normalized_coords *unaccelerated,
 			      void *data,
 			      uint64_t time)
@@ -320,6 +574,7 @@ calculate_acceleration_factor(struct pointer_accelerator *accel,
 	feed_trackers(accel, unaccelerated, time);
 	velocity = calculate_velocity(accel, time);
 	accel_factor = calculate_acceleration(accel,
+					      profile,
 					      data,
 					      velocity,
 					      accel->last_velocity,
@@ -340,6 +595,7 @@ accelerator_filter(struct motion_filter *filter,
 	struct normalized_coords accelerated;
 
 	accel_value = calculate_acceleration_factor(accel,
+						    accel->profile,
 						    unaccelerated,
 						    data,
 						    time);
@@ -350,6 +606,36 @@ accelerator_filter(struct motion_filter *filter,
 	return accelerated;
 }
 
+static void
+accelerator_filter_batch(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 struct normalized_coords *accelerated,
+			 const uint64_t *time,
+			 size_t ndeltas,
+			 void *data)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	struct normalized_coords delta;
+	double accel_value; /* unitless factor */
+	size_t i;
+
+	/* The velocity depends on all previous deltas, so this is the same
+	 * sequence of operations as accelerator_filter() minus the
+	 * indirect call per delta */
+	for (i = 0; i < ndeltas; i++) {
+		delta = unaccelerated[i];
+		accel_value = calculate_acceleration_factor(accel,
+							    accel->profile,
+							    &delta,
+							    data,
+							    time[i]);
+
+		accelerated[i].x = accel_value * delta.x;
+		accelerated[i].y = accel_value * delta.y;
+	}
+}
+
 static struct normalized_coords
 accelerator_filter_noop(struct motion_filter *filter,
 			const struct normalized_coords *unaccelerated,
@@ -377,6 +663,7 @@ accelerator_filter_low_dpi(struct motion_filter *filter,
 	unnormalized.y = unaccelerated->y * dpi_factor;
 
 	accel_value = calculate_acceleration_factor(accel,
+						    accel->profile,
 						    &unnormalized,
 						    data,
 						    time);
@@ -407,6 +694,7 @@ accelerator_filter_trackpoint(struct motion_filter *filter,
 	unnormalized.y = unaccelerated->y * dpi_factor;
 
 	accel_value = calculate_acceleration_factor(accel,
+						    accel->profile,
 						    &unnormalized,
 						    data,
 						    time);
@@ -431,6 +719,7 @@ accelerator_filter_x230(struct motion_filter *filter,
 	feed_trackers(accel, unaccelerated, time);
 	velocity = calculate_velocity(accel, time);
 	accel_factor = calculate_acceleration(accel,
+					      accel->profile,
 					      data,
 					      velocity,
 					      accel->last_velocity,
@@ -481,17 +770,14 @@ accelerator_restart(struct motion_filter *filter,
 	unsigned int offset;
 	struct pointer_tracker *tracker;
 
+	tracker_ring_restart(&accel->ring, time);
+
+	/* the current tracker keeps its delta */
 	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
 		tracker = tracker_by_offset(accel, offset);
-		tracker->time = 0;
-		tracker->dir = 0;
-		tracker->delta.x = 0;
-		tracker->delta.y = 0;
+		tracker->origin = accel->delta_sum;
+		tracker->start = accel->delta_sum;
 	}
-
-	tracker = tracker_by_offset(accel, 0);
-	tracker->time = time;
-	tracker->dir = UNDEFINED_DIRECTION;
 }
 
 static void
@@ -501,6 +787,7 @@ accelerator_destroy(struct motion_filter *filter)
 		(struct pointer_accelerator *) filter;
 
 	free(accel->trackers);
+	free(accel->curve);
 	free(accel);
 }
 
@@ -529,6 +816,8 @@ accelerator_set_speed(struct motion_filter *filter,
 	accel_filter->incline = DEFAULT_INCLINE + speed_adjustment * 0.75;
 
 	filter->speed_adjustment = speed_adjustment;
+	accelerator_update_lut(accel_filter);
+
 	return true;
 }
 
@@ -734,29 +1023,60 @@ trackpoint_accel_profile(struct motion_filter *filter,
 	return factor;
 }
 
+/**
+ * Acceleration function for a caller-supplied curve. The factor is
+ * interpolated between the two closest points, outside of the curve the
+ * factor of the first or last point applies.
+ *
+ * This is only evaluated when building the lookup table and above the
+ * last point, the table covers everything in between.
+ */
+double
+custom_accel_profile(struct motion_filter *filter,
+		     void *data,
+		     double speed_in, /* 1000-dpi normalized */
+		     uint64_t time)
+{
+	struct pointer_accelerator *accel_filter =
+		(struct pointer_accelerator *)filter;
+	const struct accel_curve *curve = accel_filter->curve;
+	size_t last = curve->npoints - 1;
+	double frac;
+	size_t i;
+
+	if (speed_in >= curve->velocity[last])
+		return curve->factor[last];
+
+	if (speed_in <= curve->velocity[0])
+		return curve->factor[0];
+
+	for (i = 1; speed_in >= curve->velocity[i]; i++)
+		;
+
+	frac = (speed_in - curve->velocity[i - 1]) /
+	       (curve->velocity[i] - curve->velocity[i - 1]);
+
+	return curve->factor[i - 1] +
+	       (curve->factor[i] - curve->factor[i - 1]) * frac;
+}
+
 struct motion_filter_interface accelerator_interface = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter,
+	.filter_batch = accelerator_filter_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
 	.set_speed = accelerator_set_speed,
 };
 
-static struct pointer_accelerator *
-create_default_filter(int dpi)
+static void
+init_default_filter(struct pointer_accelerator *filter, int dpi)
 {
-	struct pointer_accelerator *filter;
-
-	filter = zalloc(sizeof *filter);
-	if (filter == NULL)
-		return NULL;
-
 	filter->last_velocity = 0.0;
 
 	filter->trackers =
 		calloc(NUM_POINTER_TRACKERS, sizeof *filter->trackers);
-	filter->cur_tracker = 0;
 
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
@@ -764,6 +1084,20 @@ create_default_filter(int dpi)
 
 	filter->dpi_factor = dpi/(double)DEFAULT_MOUSE_DPI;
 
+	filter->lut_max_velocity = ACCEL_LUT_MAX_VELOCITY;
+}
+
+static struct pointer_accelerator *
+create_default_filter(int dpi)
+{
+	struct pointer_accelerator *filter;
+
+	filter = zalloc(sizeof *filter);
+	if (filter == NULL)
+		return NULL;
+
+	init_default_filter(filter, dpi);
+
 	return filter;
 }
 
@@ -778,6 +1112,7 @@ create_pointer_accelerator_filter_linear(int dpi)
 
 	filter->base.interface = &accelerator_interface;
 	filter->profile = pointer_accel_profile_linear;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
@@ -802,6 +1137,7 @@ create_pointer_accelerator_filter_linear_low_dpi(int dpi)
 
 	filter->base.interface = &accelerator_interface_low_dpi;
 	filter->profile = pointer_accel_profile_linear_low_dpi;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
@@ -809,6 +1145,7 @@ create_pointer_accelerator_filter_linear_low_dpi(int dpi)
 struct motion_filter_interface accelerator_interface_touchpad = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter,
+	.filter_batch = accelerator_filter_batch,
 	.filter_constant = touchpad_constant_filter,
 	.restart = accelerator_restart,
 	.destroy = accelerator_destroy,
@@ -826,10 +1163,70 @@ create_pointer_accelerator_filter_touchpad(int dpi)
 
 	filter->base.interface = &accelerator_interface_touchpad;
 	filter->profile = touchpad_accel_profile_linear;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
 
+enum filter_dispatch_type
+filter_get_dispatch_type(struct motion_filter *filter)
+{
+	/* Each of these interfaces is only used with a single profile,
+	 * see the create_pointer_accelerator_filter_* functions */
+	if (filter->interface == &accelerator_interface)
+		return FILTER_DISPATCH_LINEAR;
+
+	if (filter->interface == &accelerator_interface_touchpad)
+		return FILTER_DISPATCH_TOUCHPAD;
+
+	return FILTER_DISPATCH_GENERIC;
+}
+
+/* accelerator_filter() with the profile known at compile time */
+struct normalized_coords
+filter_dispatch_linear(struct motion_filter *filter,
+		       const struct normalized_coords *unaccelerated,
+		       void *data, uint64_t time)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	double accel_value; /* unitless factor */
+	struct normalized_coords accelerated;
+
+	accel_value = calculate_acceleration_factor(accel,
+						    pointer_accel_profile_linear,
+						    unaccelerated,
+						    data,
+						    time);
+
+	accelerated.x = accel_value * unaccelerated->x;
+	accelerated.y = accel_value * unaccelerated->y;
+
+	return accelerated;
+}
+
+struct normalized_coords
+filter_dispatch_touchpad(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 void *data, uint64_t time)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *) filter;
+	double accel_value; /* unitless factor */
+	struct normalized_coords accelerated;
+
+	accel_value = calculate_acceleration_factor(accel,
+						    touchpad_accel_profile_linear,
+						    unaccelerated,
+						    data,
+						    time);
+
+	accelerated.x = accel_value * unaccelerated->x;
+	accelerated.y = accel_value * unaccelerated->y;
+
+	return accelerated;
+}
+
 struct motion_filter_interface accelerator_interface_x230 = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
 	.filter = accelerator_filter_x230,
@@ -858,7 +1255,6 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi)
 
 	filter->trackers =
 		calloc(NUM_POINTER_TRACKERS, sizeof *filter->trackers);
-	filter->cur_tracker = 0;
 
 	filter->threshold = X230_THRESHOLD;
 	filter->accel = X230_ACCELERATION; /* unitless factor */
@@ -866,6 +1262,9 @@ create_pointer_accelerator_filter_lenovo_x230(int dpi)
 
 	filter->dpi_factor = 1; /* unused for this accel method */
 
+	filter->lut_max_velocity = ACCEL_LUT_MAX_VELOCITY;
+	accelerator_update_lut(filter);
+
 	return &filter->base;
 }
 
@@ -892,10 +1291,546 @@ create_pointer_accelerator_filter_trackpoint(int dpi)
 	filter->threshold = DEFAULT_THRESHOLD;
 	filter->accel = DEFAULT_ACCELERATION;
 	filter->incline = DEFAULT_INCLINE;
+	accelerator_update_lut(filter);
 
 	return &filter->base;
 }
 
+struct motion_filter_interface accelerator_interface_custom = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM,
+	.filter = accelerator_filter,
+	.filter_batch = accelerator_filter_batch,
+	.filter_constant = accelerator_filter_noop,
+	.restart = accelerator_restart,
+	.destroy = accelerator_destroy,
+	.set_speed = accelerator_set_speed,
+};
+
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi,
+					 const double *velocities,
+					 const double *factors,
+					 size_t npoints)
+{
+	struct pointer_accelerator *filter;
+	struct accel_curve *curve;
+	size_t i;
+
+	assert(npoints > 0 && npoints <= ACCEL_CUSTOM_MAX_POINTS);
+
+	filter = create_default_filter(dpi);
+	if (!filter)
+		return NULL;
+
+	curve = zalloc(sizeof *curve);
+	if (!curve) {
+		accelerator_destroy(&filter->base);
+		return NULL;
+	}
+
+	for (i = 0; i < npoints; i++) {
+		curve->velocity[i] = v_ms2us(velocities[i]);
+		curve->factor[i] = factors[i];
+	}
+	curve->npoints = npoints;
+
+	filter->base.interface = &accelerator_interface_custom;
+	filter->profile = custom_accel_profile;
+	filter->curve = curve;
+
+	/* The table spans the curve, the profile above it is constant.
+	 * A single point at 0 is a constant profile too, any range will
+	 * do. */
+	if (curve->velocity[npoints - 1] > 0.0)
+		filter->lut_max_velocity = curve->velocity[npoints - 1];
+	accelerator_update_lut(filter);
+
+	return &filter->base;
+}
+
+/*
+ * Fixed-point variants of the linear, touchpad and trackpoint
+ * accelerators for CPUs without a fast FPU. Deltas, velocities and
+ * factors are Q16.16, only the conversion of the deltas in and out of the
+ * filter uses floating point. The profile parameters and the profile's
+ * lookup table are shared with the floating point accelerator, the table
+ * is converted whenever it changes.
+ */
+
+#define FIXED_SHIFT		16
+#define FIXED_ONE		(1 << FIXED_SHIFT)
+#define FIXED_MAX_VELOCITY_DIFF	(1 * FIXED_ONE) /* units/ms */
+
+struct fixed_coords {
+	int64_t x, y; /* Q16.16 units */
+};
+
+/* time and direction are in base.ring */
+struct pointer_tracker_fixed {
+	struct fixed_coords origin; /* running sum at creation */
+	struct fixed_coords start; /* running sum before creation */
+};
+
+struct pointer_accelerator_fixed {
+	struct pointer_accelerator base;
+
+	/* deltas are multiplied with this before conversion */
+	double input_factor;
+
+	/* The running sum does not need rebasing, it takes 2^47 units to
+	 * overflow */
+	struct pointer_tracker_fixed trackers[NUM_POINTER_TRACKERS];
+	struct fixed_coords delta_sum;
+
+	int64_t last_velocity;	/* Q16.16 units/ms */
+
+	int32_t lut[ACCEL_LUT_SIZE + 1]; /* Q16.16 */
+	int64_t lut_max_velocity;	/* Q16.16 units/ms */
+};
+
+static inline int64_t
+fixed_from_double(double value)
+{
+	return (int64_t)(value * FIXED_ONE + (value < 0.0 ? -0.5 : 0.5));
+}
+
+static uint64_t
+isqrt64(uint64_t value)
+{
+	uint64_t result = 0;
+	uint64_t bit = 1ULL << 62;
+
+	while (bit > value)
+		bit >>= 2;
+
+	while (bit != 0) {
+		if (value >= result + bit) {
+			value -= result + bit;
+			result = (result >> 1) + bit;
+		} else {
+			result >>= 1;
+		}
+		bit >>= 2;
+	}
+
+	return result;
+}
+
+/* Q16.16 length. The components are reduced to Q12 first so the squares
+ * can't overflow for anything below 2^19 units. */
+static inline int64_t
+fixed_length(int64_t x, int64_t y)
+{
+	uint64_t x12 = (x < 0 ? -x : x) >> 4,
+		 y12 = (y < 0 ? -y : y) >> 4;
+
+	return (int64_t)isqrt64(x12 * x12 + y12 * y12) << 4;
+}
+
+/* Same as normalized_get_direction(), the octant boundaries are compared
+ * as slopes instead of using atan2 */
+static int
+fixed_get_direction(int64_t x, int64_t y)
+{
+	/* tan(0.1π/4), tan(0.9π/4), tan(1.1π/4), tan(1.9π/4) */
+	static const int64_t slopes[] = {
+		5158,		/* 0.078702 */
+		55973,		/* 0.854081 */
+		76733,		/* 1.170850 */
+		832714,	/* 12.706205 */
+	};
+	int64_t ax = x < 0 ? -x : x,
+		ay = y < 0 ? -y : y;
+	int axis_x, axis_y, diagonal;
+	int sector;
+
+	if (ax < 2 * FIXED_ONE && ay < 2 * FIXED_ONE) {
+		if (x > 0 && y > 0)
+			return S | SE | E;
+		else if (x > 0 && y < 0)
+			return N | NE | E;
+		else if (x < 0 && y > 0)
+			return S | SW | W;
+		else if (x < 0 && y < 0)
+			return N | NW | W;
+		else if (x > 0)
+			return NE | E | SE;
+		else if (x < 0)
+			return NW | W | SW;
+		else if (y > 0)
+			return SE | S | SW;
+		else if (y < 0)
+			return NE | N | NW;
+		return UNDEFINED_DIRECTION;
+	}
+
+	axis_x = x > 0 ? E : W;
+	axis_y = y > 0 ? S : N;
+	if (x > 0)
+		diagonal = y > 0 ? SE : NE;
+	else
+		diagonal = y > 0 ? SW : NW;
+
+	/* angle from the x axis: close to the axis, between axis and
+	 * diagonal, close to the diagonal, etc. */
+	for (sector = 0; sector < 4; sector++) {
+		if (ay * FIXED_ONE < ax * slopes[sector])
+			break;
+	}
+
+	switch (sector) {
+	case 0:
+		return axis_x;
+	case 1:
+		return axis_x | diagonal;
+	case 2:
+		return diagonal;
+	case 3:
+		return diagonal | axis_y;
+	default:
+		return axis_y;
+	}
+}
+
+static void
+fixed_update_lut(struct pointer_accelerator_fixed *accel)
+{
+	int i;
+
+	for (i = 0; i <= ACCEL_LUT_SIZE; i++)
+		accel->lut[i] = fixed_from_double(accel->base.lut[i]);
+
+	accel->lut_max_velocity =
+		fixed_from_double(v_us2ms(accel->base.lut_max_velocity));
+}
+
+static struct pointer_tracker_fixed *
+fixed_tracker_by_offset(struct pointer_accelerator_fixed *accel,
+			unsigned int offset)
+{
+	return &accel->trackers[tracker_index(&accel->base.ring, offset)];
+}
+
+/* see feed_trackers() */
+static void
+fixed_feed_trackers(struct pointer_accelerator_fixed *accel,
+		    const struct fixed_coords *delta,
+		    uint64_t time)
+{
+	struct pointer_tracker_fixed *tracker;
+	struct tracker_ring *ring = &accel->base.ring;
+	bool merge;
+
+	accel->delta_sum.x += delta->x;
+	accel->delta_sum.y += delta->y;
+
+	merge = tracker_ring_feed(ring, time);
+	tracker = fixed_tracker_by_offset(accel, 0);
+	if (!merge) {
+		tracker->origin = accel->delta_sum;
+		tracker->start.x = accel->delta_sum.x - delta->x;
+		tracker->start.y = accel->delta_sum.y - delta->y;
+	}
+
+	ring->dir[ring->cur] =
+		fixed_get_direction(accel->delta_sum.x - tracker->start.x,
+				    accel->delta_sum.y - tracker->start.y);
+}
+
+static int64_t
+fixed_calculate_tracker_velocity(struct pointer_accelerator_fixed *accel,
+				 unsigned int offset,
+				 uint64_t time)
+{
+	struct pointer_tracker_fixed *tracker =
+		fixed_tracker_by_offset(accel, offset);
+	uint64_t tracker_time =
+		accel->base.ring.time[tracker_index(&accel->base.ring, offset)];
+	int64_t length;
+	uint64_t tdelta = time - tracker_time + 1;
+
+	length = fixed_length(accel->delta_sum.x - tracker->origin.x,
+			      accel->delta_sum.y - tracker->origin.y);
+
+	return length * 1000 / (int64_t)tdelta; /* Q16.16 units/ms */
+}
+
+/* see calculate_velocity() */
+static int64_t
+fixed_calculate_velocity(struct pointer_accelerator_fixed *accel,
+			 uint64_t time)
+{
+	struct tracker_ring *ring = &accel->base.ring;
+	int64_t velocity;
+	int64_t result = 0;
+	int64_t initial_velocity = 0;
+	int64_t velocity_diff;
+	unsigned int offset, ntrackers;
+	bool timed_out;
+
+	ntrackers = tracker_ring_count_valid(ring, time, &timed_out);
+	if (ntrackers == 0) {
+		/* see calculate_velocity_after_timeout() */
+		if (timed_out)
+			time = ring->time[tracker_index(ring, 1)] +
+			       MOTION_TIMEOUT;
+		return fixed_calculate_tracker_velocity(accel, 1, time);
+	}
+
+	for (offset = 1; offset <= ntrackers; offset++) {
+		velocity = fixed_calculate_tracker_velocity(accel,
+							    offset,
+							    time);
+
+		if (initial_velocity == 0) {
+			result = initial_velocity = velocity;
+		} else {
+			velocity_diff = initial_velocity - velocity;
+			if (velocity_diff < 0)
+				velocity_diff = -velocity_diff;
+			if (velocity_diff > FIXED_MAX_VELOCITY_DIFF)
+				break;
+
+			result = velocity;
+		}
+	}
+
+	return result; /* Q16.16 units/ms */
+}
+
+static inline int64_t
+fixed_acceleration_profile(struct pointer_accelerator_fixed *accel,
+			   void *data, int64_t velocity, uint64_t time)
+{
+	int64_t pos = velocity * ACCEL_LUT_SIZE;
+	int64_t idx, frac;
+	double factor;
+
+	idx = pos / accel->lut_max_velocity;
+	if (idx >= ACCEL_LUT_SIZE) {
+		/* rare enough that floating point is acceptable */
+		factor = accel->base.profile(&accel->base.base,
+					     data,
+					     v_ms2us((double)velocity / FIXED_ONE),
+					     time);
+		return fixed_from_double(factor);
+	}
+
+	frac = pos - idx * accel->lut_max_velocity;
+
+	return accel->lut[idx] +
+	       (accel->lut[idx + 1] - accel->lut[idx]) * frac /
+	       accel->lut_max_velocity;
+}
+
+static struct normalized_coords
+accelerator_filter_fixed(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 void *data, uint64_t time)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	struct normalized_coords unnormalized, accelerated;
+	struct fixed_coords delta;
+	int64_t velocity; /* Q16.16 units/ms */
+	int64_t factor; /* Q16.16 */
+	double scale;
+
+	unnormalized.x = unaccelerated->x * accel->input_factor;
+	unnormalized.y = unaccelerated->y * accel->input_factor;
+	delta.x = fixed_from_double(unnormalized.x);
+	delta.y = fixed_from_double(unnormalized.y);
+
+	fixed_feed_trackers(accel, &delta, time);
+	velocity = fixed_calculate_velocity(accel, time);
+
+	/* Simpson's rule, see calculate_acceleration() */
+	factor = fixed_acceleration_profile(accel, data, velocity, time);
+	factor += fixed_acceleration_profile(accel,
+					     data,
+					     accel->last_velocity,
+					     time);
+	factor += 4 * fixed_acceleration_profile(accel,
+						 data,
+						 (accel->last_velocity +
+						  velocity) / 2,
+						 time);
+	factor /= 6;
+
+	accel->last_velocity = velocity;
+
+	scale = (double)factor / FIXED_ONE;
+	accelerated.x = scale * unnormalized.x;
+	accelerated.y = scale * unnormalized.y;
+
+	return accelerated;
+}
+
+static void
+accelerator_restart_fixed(struct motion_filter *filter,
+			  void *data,
+			  uint64_t time)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+	unsigned int offset;
+	struct pointer_tracker_fixed *tracker;
+
+	tracker_ring_restart(&accel->base.ring, time);
+
+	for (offset = 1; offset < NUM_POINTER_TRACKERS; offset++) {
+		tracker = fixed_tracker_by_offset(accel, offset);
+		tracker->origin = accel->delta_sum;
+		tracker->start = accel->delta_sum;
+	}
+}
+
+static bool
+accelerator_set_speed_fixed(struct motion_filter *filter,
+			    double speed_adjustment)
+{
+	struct pointer_accelerator_fixed *accel =
+		(struct pointer_accelerator_fixed *) filter;
+
+	if (!accelerator_set_speed(filter, speed_adjustment))
+		return false;
+
+	fixed_update_lut(accel);
+
+	return true;
+}
+
+struct motion_filter_interface accelerator_interface_fixed = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
+	.filter = accelerator_filter_fixed,
+	.filter_constant = accelerator_filter_noop,
+	.restart = accelerator_restart_fixed,
+	.destroy = accelerator_destroy,
+	.set_speed = accelerator_set_speed_fixed,
+};
+
+struct motion_filter_interface accelerator_interface_touchpad_fixed = {
+	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE,
+	.filter = accelerator_filter_fixed,
+	.filter_constant = touchpad_constant_filter,
+	.restart = accelerator_restart_fixed,
+	.destroy = accelerator_destroy,
+	.set_speed = accelerator_set_speed_fixed,
+};
+
+/* All filters with these interfaces are a struct pointer_accelerator, or
+ * embed one, and sample their profile into the lookup table */
+static bool
+filter_has_profile(struct motion_filter *filter)
+{
+	return filter->interface == &accelerator_interface ||
+	       filter->interface == &accelerator_interface_low_dpi ||
+	       filter->interface == &accelerator_interface_touchpad ||
+	       filter->interface == &accelerator_interface_x230 ||
+	       filter->interface == &accelerator_interface_trackpoint ||
+	       filter->interface == &accelerator_interface_custom ||
+	       filter->interface == &accelerator_interface_fixed ||
+	       filter->interface == &accelerator_interface_touchpad_fixed;
+}
+
+accel_profile_func_t
+pointer_accelerator_get_profile(struct motion_filter *filter)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *)filter;
+
+	if (!filter_has_profile(filter))
+		return NULL;
+
+	return accel->profile;
+}
+
+bool
+pointer_accelerator_lookup_factor(struct motion_filter *filter,
+				  double velocity,
+				  double *factor)
+{
+	struct pointer_accelerator *accel =
+		(struct pointer_accelerator *)filter;
+
+	if (!filter_has_profile(filter))
+		return false;
+
+	*factor = acceleration_profile(accel,
+				       accel->profile,
+				       NULL,
+				       velocity,
+				       0);
+	return true;
+}
+
+static struct pointer_accelerator_fixed *
+create_fixed_filter(int dpi,
+		    struct motion_filter_interface *interface,
+		    accel_profile_func_t profile)
+{
+	struct pointer_accelerator_fixed *filter;
+
+	filter = zalloc(sizeof *filter);
+	if (filter == NULL)
+		return NULL;
+
+	init_default_filter(&filter->base, dpi);
+	filter->base.base.interface = interface;
+	filter->base.profile = profile;
+	filter->input_factor = 1.0;
+
+	accelerator_update_lut(&filter->base);
+	fixed_update_lut(filter);
+
+	return filter;
+}
+
+struct motion_filter *
+create_pointer_accelerator_filter_linear_fixed(int dpi)
+{
+	struct pointer_accelerator_fixed *filter;
+
+	filter = create_fixed_filter(dpi,
+				     &accelerator_interface_fixed,
+				     pointer_accel_profile_linear);
+	if (!filter)
+		return NULL;
+
+	return &filter->base.base;
+}
+
+struct motion_filter *
+create_pointer_accelerator_filter_touchpad_fixed(int dpi)
+{
+	struct pointer_accelerator_fixed *filter;
+
+	filter = create_fixed_filter(dpi,
+				     &accelerator_interface_touchpad_fixed,
+				     touchpad_accel_profile_linear);
+	if (!filter)
+		return NULL;
+
+	return &filter->base.base;
+}
+
+struct motion_filter *
+create_pointer_accelerator_filter_trackpoint_fixed(int dpi)
+{
+	struct pointer_accelerator_fixed *filter;
+
+	filter = create_fixed_filter(dpi,
+				     &accelerator_interface_fixed,
+				     trackpoint_accel_profile);
+	if (!filter)
+		return NULL;
+
+	/* see accelerator_filter_trackpoint() */
+	filter->input_factor = min(1.0, filter->base.dpi_factor);
+
+	return &filter->base.base;
+}
+
 static struct normalized_coords
 accelerator_filter_flat(struct motion_filter *filter,
 			const struct normalized_coords *unaccelerated,
@@ -919,6 +1854,30 @@ accelerator_filter_flat(struct motion_filter *filter,
 	return accelerated;
 }
 
+static void
+accelerator_filter_flat_batch(struct motion_filter *filter,
+			      const struct normalized_coords *unaccelerated,
+			      struct normalized_coords *accelerated,
+			      const uint64_t *time,
+			      size_t ndeltas,
+			      void *data)
+{
+	struct pointer_accelerator_flat *accel_filter =
+		(struct pointer_accelerator_flat *)filter;
+	const double factor = accel_filter->factor;
+	const double dpi_factor = accel_filter->dpi_factor;
+	size_t i;
+
+	/* Same operations in the same order as accelerator_filter_flat(),
+	 * so the results are bit-identical. There is no dependency between
+	 * iterations, so the compiler can vectorize this loop for whatever
+	 * the target supports. */
+	for (i = 0; i < ndeltas; i++) {
+		accelerated[i].x = factor * (unaccelerated[i].x * dpi_factor);
+		accelerated[i].y = factor * (unaccelerated[i].y * dpi_factor);
+	}
+}
+
 static bool
 accelerator_set_speed_flat(struct motion_filter *filter,
 			   double speed_adjustment)
@@ -951,6 +1910,7 @@ accelerator_destroy_flat(struct motion_filter *filter)
 struct motion_filter_interface accelerator_interface_flat = {
 	.type = LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT,
 	.filter = accelerator_filter_flat,
+	.filter_batch = accelerator_filter_flat_batch,
 	.filter_constant = accelerator_filter_noop,
 	.restart = NULL,
 	.destroy = accelerator_destroy_flat,
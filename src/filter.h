@@ -28,6 +28,7 @@
 #include "config.h"
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "libinput-private.h"
@@ -48,6 +49,62 @@ filter_dispatch(struct motion_filter *filter,
 		const struct normalized_coords *unaccelerated,
 		void *data, uint64_t time);
 
+/**
+ * Accelerate an array of deltas. This is equivalent to calling
+ * filter_dispatch() for each delta in order and produces identical
+ * results, but avoids the per-delta overhead where the filter supports
+ * it.
+ *
+ * The accelerated array may be the same as the unaccelerated array.
+ *
+ * @param unaccelerated ndeltas unaccelerated deltas
+ * @param accelerated ndeltas accelerated deltas on return
+ * @param time ndeltas timestamps, one for each delta
+ * @param ndeltas Number of deltas
+ *
+ * @see filter_dispatch
+ */
+void
+filter_dispatch_batch(struct motion_filter *filter,
+		      const struct normalized_coords *unaccelerated,
+		      struct normalized_coords *accelerated,
+		      const uint64_t *time,
+		      size_t ndeltas,
+		      void *data);
+
+/* Filters with a specialized dispatch function */
+enum filter_dispatch_type {
+	FILTER_DISPATCH_GENERIC = 0,	/* use filter_dispatch() */
+	FILTER_DISPATCH_LINEAR,		/* use filter_dispatch_linear() */
+	FILTER_DISPATCH_TOUCHPAD,	/* use filter_dispatch_touchpad() */
+};
+
+/**
+ * Return the specialized dispatch function usable for this filter. The
+ * specialized functions are equivalent to filter_dispatch() but skip the
+ * indirect calls through the filter interface and the profile, so a
+ * caller should look this up once per filter and then call the
+ * specialized function directly.
+ */
+enum filter_dispatch_type
+filter_get_dispatch_type(struct motion_filter *filter);
+
+/**
+ * filter_dispatch() for a filter of type FILTER_DISPATCH_LINEAR.
+ */
+struct normalized_coords
+filter_dispatch_linear(struct motion_filter *filter,
+		       const struct normalized_coords *unaccelerated,
+		       void *data, uint64_t time);
+
+/**
+ * filter_dispatch() for a filter of type FILTER_DISPATCH_TOUCHPAD.
+ */
+struct normalized_coords
+filter_dispatch_touchpad(struct motion_filter *filter,
+			 const struct normalized_coords *unaccelerated,
+			 void *data, uint64_t time);
+
 /**
  * Apply constant motion filters, but no acceleration.
  *
@@ -104,10 +161,45 @@ create_pointer_accelerator_filter_trackpoint(int dpi);
 struct motion_filter *
 create_pointer_accelerator_filter_tablet(int xres, int yres);
 
+/* Fixed-point implementations of the filters above, the results differ
+ * from the floating point filters only by rounding */
+struct motion_filter *
+create_pointer_accelerator_filter_linear_fixed(int dpi);
+
+struct motion_filter *
+create_pointer_accelerator_filter_touchpad_fixed(int dpi);
+
+struct motion_filter *
+create_pointer_accelerator_filter_trackpoint_fixed(int dpi);
+
+/* velocities are in units/ms, see
+ * libinput_device_config_accel_set_custom_points() */
+struct motion_filter *
+create_pointer_accelerator_filter_custom(int dpi,
+					 const double *velocities,
+					 const double *factors,
+					 size_t npoints);
+
 /*
  * Pointer acceleration profiles.
  */
 
+/* Return the profile of an adaptive pointer accelerator filter, or NULL
+ * for filters without a profile (e.g. flat or tablet).
+ */
+accel_profile_func_t
+pointer_accelerator_get_profile(struct motion_filter *filter);
+
+/* Get the acceleration factor the filter uses for the given velocity,
+ * interpolated from the filter's lookup table where available. Returns
+ * false for filters without a profile. Used to validate the lookup table
+ * against the profile functions.
+ */
+bool
+pointer_accelerator_lookup_factor(struct motion_filter *filter,
+				  double velocity,
+				  double *factor);
+
 double
 pointer_accel_profile_linear_low_dpi(struct motion_filter *filter,
 				     void *data,
@@ -133,4 +225,9 @@ trackpoint_accel_profile(struct motion_filter *filter,
 			 void *data,
 			 double speed_in,
 			 uint64_t time);
+double
+custom_accel_profile(struct motion_filter *filter,
+		     void *data,
+		     double speed_in,
+		     uint64_t time);
 #endif /* FILTER_H */
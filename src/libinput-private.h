@@ -27,6 +27,7 @@
 
 #include <errno.h>
 #include <math.h>
+#include <pthread.h>
 
 #include "linux/input.h"
 
@@ -35,6 +36,14 @@
 
 struct libinput_source;
 
+/* liburing's ring, its headers are only available when building the
+ * library itself */
+struct io_uring;
+
+/* libwacom's WacomDeviceDatabase, its headers are only available when
+ * building the library itself */
+struct _WacomDeviceDatabase;
+
 /* A coordinate pair in device coordinates */
 struct device_coords {
 	int x, y;
@@ -94,16 +103,105 @@ struct libinput_interface_backend {
 				  const char *seat_name);
 };
 
+/* Events are allocated from per-type pools, one for each of the event
+ * structs in libinput.c */
+enum libinput_event_pool_type {
+	EVENT_POOL_DEVICE_NOTIFY,
+	EVENT_POOL_KEYBOARD,
+	EVENT_POOL_POINTER,
+	EVENT_POOL_TOUCH,
+	EVENT_POOL_GESTURE,
+	EVENT_POOL_TABLET_TOOL,
+
+	EVENT_POOL_COUNT,
+};
+
+struct libinput_event_pool {
+	void *free_list;	/* linked through the first word of each entry */
+	unsigned int nfree;
+
+	uint64_t hits;		/* allocations served from the free list */
+	uint64_t misses;	/* allocations that needed malloc */
+};
+
+/* Performance counters, see libinput_get_counter(). The increments are
+ * relaxed atomics so a counter may be read from another thread, they
+ * compile to nothing without HAVE_COUNTERS. */
+#if HAVE_COUNTERS
+#define counter_add(c_, n_) __atomic_add_fetch(&(c_), (n_), __ATOMIC_RELAXED)
+#define counter_read(c_) __atomic_load_n(&(c_), __ATOMIC_RELAXED)
+#else
+#define counter_add(c_, n_) do { } while (0)
+#define counter_read(c_) ((uint64_t)0)
+#endif
+#define counter_inc(c_) counter_add(c_, 1)
+
+/* Number of event types with a per-type counter, including
+ * LIBINPUT_EVENT_DEVICE_ADDED and LIBINPUT_EVENT_DEVICE_REMOVED */
+#define EVENT_TYPE_COUNT 22
+
+/* Sources that deliver input in frames, i.e. evdev devices, can be
+ * interleaved one frame at a time, see libinput_set_dispatch_mode() */
+struct libinput_source_frame_interface {
+	/* Make the next frame available, reading from the fd if needed.
+	 * Returns false if there is none, otherwise the frame's
+	 * timestamp is returned in time */
+	bool (*peek_frame)(void *user_data, uint64_t *time);
+	/* Process the frame returned by peek_frame */
+	void (*dispatch_frame)(void *user_data);
+	/* Sources serviced first, see
+	 * libinput_set_dispatch_keyboard_priority() */
+	bool (*is_priority)(void *user_data);
+};
+
+/* Number of events in flight between the dispatch thread and the caller,
+ * in either direction */
+#define DISPATCH_THREAD_RING_SIZE 512
+
+/* Single-producer/single-consumer ring of events between the dispatch
+ * thread and the caller. The indices are free-running, only the producer
+ * writes tail and only the consumer writes head. */
+struct event_spsc_ring {
+	struct libinput_event **events;
+	size_t len;		/* always a power of two */
+	size_t head;		/* next event to consume */
+	size_t tail;		/* next slot to produce into */
+};
+
+struct libinput_dispatch_budget {
+	uint64_t deadline;	/* 0 for no time limit */
+	size_t events_left;	/* evdev events, SIZE_MAX for no limit */
+	bool exhausted;
+};
+
 struct libinput {
 	int epoll_fd;
 	struct list source_destroy_list;
+	struct list source_pending_list; /* sources with buffered input */
+	struct list source_run_list; /* frame sources with input, in order */
+	struct libinput_dispatch_budget dispatch_budget;
+	enum libinput_dispatch_mode dispatch_mode;
+	bool dispatch_keyboard_priority;
 
 	struct list seat_list;
 
 	struct {
-		struct list list;
+		/* binary min-heap of armed timers ordered by expiry */
+		struct libinput_timer **heap;
+		size_t heap_len;
+		size_t heap_size;
 		struct libinput_source *source;
 		int fd;
+		uint64_t armed_expire; /* currently programmed, 0 if disarmed */
+		bool in_handler;
+		uint64_t handler_serial;
+		/* timers expired at the start of the handler call */
+		struct libinput_timer **expired;
+		size_t expired_size;
+		uint64_t settime_skipped; /* redundant timerfd_settime calls */
+		uint64_t armed;		/* calls to libinput_timer_set */
+		uint64_t fired;
+		uint64_t expirations;	/* read buffer */
 	} timer;
 
 	struct libinput_event **events;
@@ -111,8 +209,74 @@ struct libinput {
 	size_t events_len;
 	size_t events_in;
 	size_t events_out;
+	enum libinput_event_queue_overflow events_overflow;
+	bool events_coalesce_motion;
+	uint32_t events_unsubscribed; /* bitmask of event types */
+	size_t events_high_watermark;
+	uint64_t events_dropped;
+	uint64_t events_coalesced;
+	uint64_t events_grown;		/* ring reallocations on overflow */
+	uint64_t events_posted[EVENT_TYPE_COUNT];
+	bool latency_histogram_enabled;
+
+	struct libinput_event_pool event_pools[EVENT_POOL_COUNT];
+
+	/* See libinput_queue_config_command(). The lock protects the
+	 * queue and the fds, it is taken from any thread */
+	struct {
+		pthread_mutex_t lock;
+		struct list queue;
+		uint64_t serial;	/* of the last queued command */
+		uint64_t completed;	/* atomic, last applied serial */
+		int queue_fd;		/* wakes the dispatch */
+		struct libinput_source *source;
+		int completion_fd;
+	} config_commands;
 
-	struct list tool_list;
+	/* See libinput_dispatch_thread_start(). Everything but the rings
+	 * and the flags marked atomic belongs to the caller's thread. */
+	struct {
+		bool active;
+		bool stop;		/* atomic */
+		bool wake_on_consume;	/* atomic, published ring was full */
+		pthread_t thread;
+		pthread_mutex_t lock;	/* held by the thread while dispatching */
+		bool caller_locked;	/* atomic, lock taken by lock_owner */
+		pthread_t lock_owner;	/* see libinput_dispatch_thread_lock */
+		int event_fd;		/* events published, see libinput_get_fd */
+		int wake_fd;		/* wakes the thread */
+		struct libinput_source *wake_source;
+		struct event_spsc_ring published; /* thread to caller */
+		struct event_spsc_ring returned; /* destroyed, caller to thread */
+	} thread;
+
+	/* Tools with a serial number, hashed by (type, serial). Tools
+	 * without a serial are kept by the tablet they were seen on. */
+	struct {
+		struct list *buckets;
+		size_t nbuckets; /* always a power of two */
+		size_t ntools;
+	} tools;
+
+#if HAVE_IO_URING
+	/* See libinput_add_fd_read(). Only active if the ring could be
+	 * set up, otherwise those sources fall back to epoll. */
+	struct {
+		bool active;
+		struct io_uring *ring;
+		int event_fd;		/* completions, polled through epoll */
+		struct libinput_source *source;
+		struct list rearm_list;	/* sources waiting for a new read */
+	} uring;
+#endif
+
+#if HAVE_LIBWACOM
+	/* See libinput_libwacom_get_db() */
+	struct {
+		struct _WacomDeviceDatabase *db;
+		bool failed;
+	} libwacom;
+#endif
 
 	const struct libinput_interface *interface;
 	const struct libinput_interface_backend *interface_backend;
@@ -179,6 +343,9 @@ struct libinput_device_config_send_events {
 	enum libinput_config_send_events_mode (*get_default_mode)(struct libinput_device *device);
 };
 
+/* Maximum number of points for LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM */
+#define ACCEL_CUSTOM_MAX_POINTS 64
+
 struct libinput_device_config_accel {
 	int (*available)(struct libinput_device *device);
 	enum libinput_config_status (*set_speed)(struct libinput_device *device,
@@ -191,6 +358,10 @@ struct libinput_device_config_accel {
 						   enum libinput_config_accel_profile);
 	enum libinput_config_accel_profile (*get_profile)(struct libinput_device *device);
 	enum libinput_config_accel_profile (*get_default_profile)(struct libinput_device *device);
+	enum libinput_config_status (*set_custom_points)(struct libinput_device *device,
+							 const double *velocities,
+							 const double *factors,
+							 size_t npoints);
 };
 
 struct libinput_device_config_natural_scroll {
@@ -271,14 +442,28 @@ struct libinput_device_group {
 	struct list link;
 };
 
+/* Number of buckets in the per-device latency histogram, the last bucket
+ * collects everything above 2^31us */
+#define LATENCY_HISTOGRAM_BUCKETS 32
+
 struct libinput_device {
 	struct libinput_seat *seat;
 	struct libinput_device_group *group;
 	struct list link;
 	struct list event_listeners;
+	uint32_t events_unsubscribed; /* bitmask of event types */
 	void *user_data;
 	int refcount;
 	struct libinput_device_config config;
+	struct {
+		uint64_t evdev_events;	/* read from the device fd */
+		uint64_t syn_report;
+		uint64_t syn_dropped;
+		uint64_t filter_dispatch;
+	} counters;
+	/* event timestamp to dequeue, bucket 0 counts [0, 2)us, bucket i
+	 * counts [2^i, 2^(i+1))us */
+	uint64_t latency_histogram[LATENCY_HISTOGRAM_BUCKETS];
 };
 
 enum libinput_tablet_tool_axis {
@@ -314,6 +499,7 @@ struct libinput_tablet_tool {
 struct libinput_event {
 	enum libinput_event_type type;
 	struct libinput_device *device;
+	uint64_t time; /* in us, 0 for events without a timestamp */
 };
 
 struct libinput_event_listener {
@@ -370,10 +556,45 @@ libinput_add_fd(struct libinput *libinput,
 		libinput_source_dispatch_t dispatch,
 		void *data);
 
+struct libinput_source *
+libinput_add_fd_read(struct libinput *libinput,
+		     int fd,
+		     void *buf,
+		     size_t len,
+		     libinput_source_dispatch_t dispatch,
+		     void *data);
+
+ssize_t
+libinput_source_read(struct libinput *libinput,
+		     struct libinput_source *source);
+
 void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source);
 
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source,
+			    bool pending);
+
+void
+libinput_source_set_frame_interface(struct libinput_source *source,
+				    const struct libinput_source_frame_interface *interface);
+
+struct libinput_tablet_tool *
+libinput_tablet_tool_find(struct libinput *libinput,
+			  enum libinput_tablet_tool_type type,
+			  uint32_t serial);
+
+int
+libinput_tablet_tool_add(struct libinput *libinput,
+			 struct libinput_tablet_tool *tool);
+
+#if HAVE_LIBWACOM
+struct _WacomDeviceDatabase *
+libinput_libwacom_get_db(struct libinput *libinput);
+#endif
+
 int
 open_restricted(struct libinput *libinput,
 		const char *path, int flags);
@@ -557,6 +778,30 @@ libinput_now(struct libinput *libinput)
 	return s2us(ts.tv_sec) + ns2us(ts.tv_nsec);
 }
 
+/* Called for every evdev event processed during dispatch */
+static inline void
+libinput_dispatch_budget_consume(struct libinput *libinput)
+{
+	if (libinput->dispatch_budget.events_left > 0)
+		libinput->dispatch_budget.events_left--;
+}
+
+/* Checked before starting a new evdev frame. Once exhausted, the budget
+ * stays exhausted until the next call to libinput_dispatch() or
+ * libinput_dispatch_budget() */
+static inline bool
+libinput_dispatch_budget_exhausted(struct libinput *libinput)
+{
+	struct libinput_dispatch_budget *budget = &libinput->dispatch_budget;
+
+	if (!budget->exhausted)
+		budget->exhausted = budget->events_left == 0 ||
+				    (budget->deadline != 0 &&
+				     libinput_now(libinput) >= budget->deadline);
+
+	return budget->exhausted;
+}
+
 static inline struct device_float_coords
 device_delta(struct device_coords a, struct device_coords b)
 {
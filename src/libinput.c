@@ -25,13 +25,25 @@
 #include "config.h"
 
 #include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <poll.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <unistd.h>
 #include <assert.h>
 
+#if HAVE_IO_URING
+#include <liburing.h>
+#endif
+
+#if HAVE_LIBWACOM
+#include <libwacom/libwacom.h>
+#endif
+
 #include "libinput.h"
 #include "libinput-private.h"
 #include "evdev.h"
@@ -73,17 +85,46 @@ check_event_type(struct libinput *libinput,
 	return rc;
 }
 
+#if HAVE_IO_URING
+enum source_read_state {
+	SOURCE_READ_NONE = 0,	/* not read through the ring */
+	SOURCE_READ_IDLE,	/* on the rearm list */
+	SOURCE_READ_POSTED,	/* the kernel owns the buffer */
+	SOURCE_READ_COMPLETE,	/* result not consumed yet */
+};
+#endif
+
 struct libinput_source {
 	libinput_source_dispatch_t dispatch;
 	void *user_data;
 	int fd;
 	struct list link;
+	struct list pending_link;
+	bool pending;
+	const struct libinput_source_frame_interface *frame_interface;
+	struct list run_link;
+	bool runnable;
+	void *read_buf;
+	size_t read_len;
+#if HAVE_IO_URING
+	enum source_read_state read_state;
+	int read_result;
+	struct list read_link;
+#endif
 };
 
 struct libinput_event_device_notify {
 	struct libinput_event base;
 };
 
+struct config_command {
+	struct list link;
+	libinput_config_command_func_t apply;
+	libinput_config_command_func_t discard;
+	void *data;
+	uint64_t serial;
+};
+
 struct libinput_event_keyboard {
 	struct libinput_event base;
 	uint64_t time;
@@ -138,6 +179,128 @@ struct libinput_event_tablet_tool {
 	enum libinput_tablet_tool_tip_state tip_state;
 };
 
+/* Upper limit of unused events kept around per pool */
+#define EVENT_POOL_MAX_FREE 256
+
+struct event_pool_entry {
+	struct event_pool_entry *next;
+};
+
+static const size_t event_pool_sizes[EVENT_POOL_COUNT] = {
+	[EVENT_POOL_DEVICE_NOTIFY] = sizeof(struct libinput_event_device_notify),
+	[EVENT_POOL_KEYBOARD] = sizeof(struct libinput_event_keyboard),
+	[EVENT_POOL_POINTER] = sizeof(struct libinput_event_pointer),
+	[EVENT_POOL_TOUCH] = sizeof(struct libinput_event_touch),
+	[EVENT_POOL_GESTURE] = sizeof(struct libinput_event_gesture),
+	[EVENT_POOL_TABLET_TOOL] = sizeof(struct libinput_event_tablet_tool),
+};
+
+static enum libinput_event_pool_type
+event_type_to_pool(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_NONE:
+		abort();
+	case LIBINPUT_EVENT_DEVICE_ADDED:
+	case LIBINPUT_EVENT_DEVICE_REMOVED:
+		return EVENT_POOL_DEVICE_NOTIFY;
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return EVENT_POOL_KEYBOARD;
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+	case LIBINPUT_EVENT_POINTER_BUTTON:
+	case LIBINPUT_EVENT_POINTER_AXIS:
+		return EVENT_POOL_POINTER;
+	case LIBINPUT_EVENT_TOUCH_DOWN:
+	case LIBINPUT_EVENT_TOUCH_UP:
+	case LIBINPUT_EVENT_TOUCH_MOTION:
+	case LIBINPUT_EVENT_TOUCH_CANCEL:
+	case LIBINPUT_EVENT_TOUCH_FRAME:
+		return EVENT_POOL_TOUCH;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:
+		return EVENT_POOL_TABLET_TOOL;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:
+		return EVENT_POOL_GESTURE;
+	}
+
+	abort();
+}
+
+/* Returns a zeroed event from the device's context pool. In steady state
+ * every event is recycled from a previously destroyed one of the same
+ * type and no allocation happens. */
+static void *
+event_alloc(struct libinput_device *device,
+	    enum libinput_event_pool_type type)
+{
+	struct libinput_event_pool *pool =
+		&device->seat->libinput->event_pools[type];
+	struct event_pool_entry *entry = pool->free_list;
+
+	if (!entry) {
+		pool->misses++;
+		return zalloc(event_pool_sizes[type]);
+	}
+
+	pool->free_list = entry->next;
+	pool->nfree--;
+	pool->hits++;
+
+	memset(entry, 0, event_pool_sizes[type]);
+
+	return entry;
+}
+
+static void
+event_release(struct libinput *libinput, struct libinput_event *event)
+{
+	struct libinput_event_pool *pool;
+	struct event_pool_entry *entry = (struct event_pool_entry *)event;
+
+	pool = &libinput->event_pools[event_type_to_pool(event->type)];
+	if (pool->nfree >= EVENT_POOL_MAX_FREE) {
+		free(event);
+		return;
+	}
+
+	entry->next = pool->free_list;
+	pool->free_list = entry;
+	pool->nfree++;
+}
+
+static void
+libinput_event_pools_destroy(struct libinput *libinput)
+{
+	struct libinput_event_pool *pool;
+	struct event_pool_entry *entry, *next;
+	unsigned int i;
+
+	for (i = 0; i < EVENT_POOL_COUNT; i++) {
+		pool = &libinput->event_pools[i];
+
+		log_debug(libinput,
+			  "event pool %u: %" PRIu64 " hits, %" PRIu64 " misses\n",
+			  i,
+			  pool->hits,
+			  pool->misses);
+
+		for (entry = pool->free_list; entry; entry = next) {
+			next = entry->next;
+			free(entry);
+		}
+		pool->free_list = NULL;
+		pool->nfree = 0;
+	}
+}
+
 static void
 libinput_default_log_func(struct libinput *libinput,
 			  enum libinput_log_priority priority,
@@ -1473,6 +1636,14 @@ libinput_tablet_tool_unref(struct libinput_tablet_tool *tool)
 	return NULL;
 }
 
+static inline void
+eventfd_clear(int fd)
+{
+	eventfd_t value;
+
+	eventfd_read(fd, &value);
+}
+
 struct libinput_source *
 libinput_add_fd(struct libinput *libinput,
 		int fd,
@@ -1502,15 +1673,396 @@ libinput_add_fd(struct libinput *libinput,
 	return source;
 }
 
+#if HAVE_IO_URING
+#define LIBINPUT_URING_ENTRIES 256
+
+/* The poll that gates a read completes with the source's address with
+ * the lowest bit set, its completion is ignored */
+#define URING_POLL_TAG 0x1
+
+static struct io_uring_sqe *
+libinput_uring_get_sqe(struct libinput *libinput)
+{
+	struct io_uring_sqe *sqe;
+
+	sqe = io_uring_get_sqe(libinput->uring.ring);
+	if (!sqe) {
+		io_uring_submit(libinput->uring.ring);
+		sqe = io_uring_get_sqe(libinput->uring.ring);
+	}
+
+	return sqe;
+}
+
+/* Device fds are non-blocking and a read on them would complete with
+ * -EAGAIN straight away, so each read is linked to a poll */
+static bool
+libinput_uring_post_read(struct libinput *libinput,
+			 struct libinput_source *source)
+{
+	struct io_uring *ring = libinput->uring.ring;
+	struct io_uring_sqe *sqe;
+
+	if (io_uring_sq_space_left(ring) < 2)
+		io_uring_submit(ring);
+
+	sqe = libinput_uring_get_sqe(libinput);
+	if (!sqe)
+		return false;
+	io_uring_prep_poll_add(sqe, source->fd, POLLIN);
+	io_uring_sqe_set_data(sqe,
+			      (void *)((uintptr_t)source | URING_POLL_TAG));
+	sqe->flags |= IOSQE_IO_LINK;
+
+	sqe = libinput_uring_get_sqe(libinput);
+	if (!sqe)
+		return false;
+	io_uring_prep_read(sqe,
+			   source->fd,
+			   source->read_buf,
+			   source->read_len,
+			   -1);
+	io_uring_sqe_set_data(sqe, source);
+
+	source->read_state = SOURCE_READ_POSTED;
+
+	return true;
+}
+
+/* A completed read keeps its source pending until the result was
+ * consumed with libinput_source_read(). Returns the source, or NULL
+ * for completions that do not carry a read result. */
+static struct libinput_source *
+libinput_uring_complete(struct libinput *libinput,
+			struct io_uring_cqe *cqe)
+{
+	uintptr_t data = (uintptr_t)io_uring_cqe_get_data(cqe);
+	struct libinput_source *source;
+
+	if (data == 0 || (data & URING_POLL_TAG))
+		return NULL;
+
+	source = (struct libinput_source *)data;
+	source->read_result = cqe->res;
+	source->read_state = SOURCE_READ_COMPLETE;
+	libinput_source_set_pending(libinput, source, true);
+
+	return source;
+}
+
+static inline void
+libinput_dispatch_source(struct libinput *libinput,
+			 struct libinput_source *source);
+
+/* Completions are harvested from the shared completion ring, without a
+ * syscall */
+static void
+libinput_uring_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	struct io_uring_cqe *cqe;
+	struct libinput_source *source;
+
+	eventfd_clear(libinput->uring.event_fd);
+
+	while (io_uring_peek_cqe(libinput->uring.ring, &cqe) == 0) {
+		source = libinput_uring_complete(libinput, cqe);
+		io_uring_cqe_seen(libinput->uring.ring, cqe);
+
+		if (source)
+			libinput_dispatch_source(libinput, source);
+	}
+}
+
+/* Post new reads for all sources whose buffer was consumed, they go to
+ * the kernel in a single submission at the end of the dispatch */
+static void
+libinput_uring_rearm(struct libinput *libinput)
+{
+	struct libinput_source *source, *tmp;
+	bool posted = false;
+
+	list_for_each_safe(source, tmp,
+			   &libinput->uring.rearm_list,
+			   read_link) {
+		if (source->pending)
+			continue;
+
+		if (!libinput_uring_post_read(libinput, source))
+			break;
+
+		list_remove(&source->read_link);
+		posted = true;
+	}
+
+	if (posted)
+		io_uring_submit(libinput->uring.ring);
+}
+
+/* The buffer may belong to an object that is about to be freed, a
+ * posted read must be cancelled and its completion reaped first.
+ * Completions for other sources are left pending. */
+static void
+libinput_uring_cancel_read(struct libinput *libinput,
+			   struct libinput_source *source)
+{
+	struct io_uring *ring = libinput->uring.ring;
+	struct io_uring_sqe *sqe;
+	struct io_uring_cqe *cqe;
+	int rc;
+
+	switch (source->read_state) {
+	case SOURCE_READ_NONE:
+		return;
+	case SOURCE_READ_IDLE:
+		list_remove(&source->read_link);
+		break;
+	case SOURCE_READ_POSTED:
+		sqe = libinput_uring_get_sqe(libinput);
+		if (sqe)
+			io_uring_prep_cancel(sqe,
+					     (void *)((uintptr_t)source |
+						      URING_POLL_TAG),
+					     0);
+		sqe = libinput_uring_get_sqe(libinput);
+		if (sqe)
+			io_uring_prep_cancel(sqe, source, 0);
+
+		while (source->read_state == SOURCE_READ_POSTED) {
+			rc = io_uring_submit_and_wait(ring, 1);
+			if (rc < 0 && rc != -EINTR) {
+				log_bug_libinput(libinput,
+						 "failed to cancel read (%s)\n",
+						 strerror(-rc));
+				break;
+			}
+
+			while (io_uring_peek_cqe(ring, &cqe) == 0) {
+				libinput_uring_complete(libinput, cqe);
+				io_uring_cqe_seen(ring, cqe);
+			}
+		}
+		break;
+	case SOURCE_READ_COMPLETE:
+		break;
+	}
+
+	source->read_state = SOURCE_READ_NONE;
+}
+
+static void
+libinput_uring_init(struct libinput *libinput)
+{
+	struct io_uring *ring;
+	int fd;
+
+	list_init(&libinput->uring.rearm_list);
+	libinput->uring.event_fd = -1;
+
+	ring = zalloc(sizeof *ring);
+	if (!ring)
+		return;
+
+	/* Not fatal, e.g. the kernel is too old or io_uring is disabled
+	 * by policy. The sources are read through epoll instead. */
+	if (io_uring_queue_init(LIBINPUT_URING_ENTRIES, ring, 0) < 0) {
+		free(ring);
+		return;
+	}
+
+	fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (fd == -1)
+		goto err;
+
+	if (io_uring_register_eventfd(ring, fd) < 0)
+		goto err;
+
+	libinput->uring.source = libinput_add_fd(libinput,
+						 fd,
+						 libinput_uring_dispatch,
+						 libinput);
+	if (!libinput->uring.source)
+		goto err;
+
+	libinput->uring.ring = ring;
+	libinput->uring.event_fd = fd;
+	libinput->uring.active = true;
+
+	return;
+
+err:
+	if (fd != -1)
+		close(fd);
+	io_uring_queue_exit(ring);
+	free(ring);
+}
+
+/* All sources read through the ring must have been removed by now */
+static void
+libinput_uring_destroy(struct libinput *libinput)
+{
+	if (!libinput->uring.active)
+		return;
+
+	libinput_remove_source(libinput, libinput->uring.source);
+	io_uring_queue_exit(libinput->uring.ring);
+	free(libinput->uring.ring);
+	libinput->uring.ring = NULL;
+	close(libinput->uring.event_fd);
+	libinput->uring.event_fd = -1;
+	libinput->uring.active = false;
+}
+#endif
+
+/* A source whose fd is read into a fixed buffer with
+ * libinput_source_read(). With io_uring, the read is posted to the
+ * kernel ahead of time and the result is harvested with the other
+ * completions, otherwise this is a normal epoll source. */
+struct libinput_source *
+libinput_add_fd_read(struct libinput *libinput,
+		     int fd,
+		     void *buf,
+		     size_t len,
+		     libinput_source_dispatch_t dispatch,
+		     void *user_data)
+{
+	struct libinput_source *source;
+
+#if HAVE_IO_URING
+	if (libinput->uring.active) {
+		source = zalloc(sizeof *source);
+		if (!source)
+			return NULL;
+
+		source->dispatch = dispatch;
+		source->user_data = user_data;
+		source->fd = fd;
+		source->read_buf = buf;
+		source->read_len = len;
+
+		if (!libinput_uring_post_read(libinput, source)) {
+			free(source);
+			return NULL;
+		}
+		io_uring_submit(libinput->uring.ring);
+
+		return source;
+	}
+#endif
+
+	source = libinput_add_fd(libinput, fd, dispatch, user_data);
+	if (!source)
+		return NULL;
+
+	source->read_buf = buf;
+	source->read_len = len;
+
+	return source;
+}
+
+/* Returns the number of bytes read into the source's buffer, or a
+ * negative errno. -EAGAIN while a read is still posted. */
+ssize_t
+libinput_source_read(struct libinput *libinput,
+		     struct libinput_source *source)
+{
+	ssize_t len;
+
+#if HAVE_IO_URING
+	switch (source->read_state) {
+	case SOURCE_READ_POSTED:
+		return -EAGAIN;
+	case SOURCE_READ_COMPLETE:
+		source->read_state = SOURCE_READ_IDLE;
+		list_insert(&libinput->uring.rearm_list, &source->read_link);
+		libinput_source_set_pending(libinput, source, false);
+		return source->read_result;
+	case SOURCE_READ_NONE:
+	case SOURCE_READ_IDLE:
+		/* the buffer is ours, e.g. the previous read filled it
+		 * and the caller wants more */
+		break;
+	}
+#endif
+
+	len = read(source->fd, source->read_buf, source->read_len);
+
+	return len < 0 ? -errno : len;
+}
+
+static void
+libinput_source_set_runnable(struct libinput *libinput,
+			     struct libinput_source *source,
+			     bool runnable);
+
 void
 libinput_remove_source(struct libinput *libinput,
 		       struct libinput_source *source)
 {
+#if HAVE_IO_URING
+	libinput_uring_cancel_read(libinput, source);
+#endif
+	libinput_source_set_pending(libinput, source, false);
+	libinput_source_set_runnable(libinput, source, false);
 	epoll_ctl(libinput->epoll_fd, EPOLL_CTL_DEL, source->fd, NULL);
 	source->fd = -1;
 	list_insert(&libinput->source_destroy_list, &source->link);
 }
 
+/* A pending source has input buffered in userspace that epoll cannot
+ * report, it is dispatched on every libinput_dispatch() until it clears
+ * the flag. A completed read that was not consumed yet, e.g. because the
+ * dispatch budget ran out first, keeps the source pending regardless:
+ * nothing else reports it again. */
+void
+libinput_source_set_pending(struct libinput *libinput,
+			    struct libinput_source *source,
+			    bool pending)
+{
+#if HAVE_IO_URING
+	if (source->read_state == SOURCE_READ_COMPLETE)
+		pending = true;
+#endif
+
+	if (source->pending == pending)
+		return;
+
+	if (pending)
+		list_insert(libinput->source_pending_list.prev,
+			    &source->pending_link);
+	else
+		list_remove(&source->pending_link);
+
+	source->pending = pending;
+}
+
+void
+libinput_source_set_frame_interface(struct libinput_source *source,
+				    const struct libinput_source_frame_interface *interface)
+{
+	source->frame_interface = interface;
+}
+
+static void
+libinput_source_set_runnable(struct libinput *libinput,
+			     struct libinput_source *source,
+			     bool runnable)
+{
+	if (source->runnable == runnable)
+		return;
+
+	if (runnable)
+		list_insert(libinput->source_run_list.prev,
+			    &source->run_link);
+	else
+		list_remove(&source->run_link);
+
+	source->runnable = runnable;
+}
+
+static void
+libinput_drop_destroyed_sources(struct libinput *libinput);
+
 int
 libinput_init(struct libinput *libinput,
 	      const struct libinput_interface *interface,
@@ -1521,7 +2073,10 @@ libinput_init(struct libinput *libinput,
 	if (libinput->epoll_fd < 0)
 		return -1;
 
+	/* events_len must always be a power of two, the ring indices are
+	 * masked with events_len - 1 */
 	libinput->events_len = 4;
+	libinput->events_overflow = LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW;
 	libinput->events = zalloc(libinput->events_len * sizeof(*libinput->events));
 	if (!libinput->events) {
 		close(libinput->epoll_fd);
@@ -1535,11 +2090,29 @@ libinput_init(struct libinput *libinput,
 	libinput->user_data = user_data;
 	libinput->refcount = 1;
 	list_init(&libinput->source_destroy_list);
+	list_init(&libinput->source_pending_list);
+	list_init(&libinput->source_run_list);
 	list_init(&libinput->seat_list);
 	list_init(&libinput->device_group_list);
-	list_init(&libinput->tool_list);
+	libinput->thread.event_fd = -1;
+	libinput->thread.wake_fd = -1;
+	pthread_mutex_init(&libinput->thread.lock, NULL);
+	list_init(&libinput->config_commands.queue);
+	libinput->config_commands.queue_fd = -1;
+	libinput->config_commands.completion_fd = -1;
+	pthread_mutex_init(&libinput->config_commands.lock, NULL);
+
+#if HAVE_IO_URING
+	libinput_uring_init(libinput);
+#endif
 
 	if (libinput_timer_subsys_init(libinput) != 0) {
+#if HAVE_IO_URING
+		libinput_uring_destroy(libinput);
+		libinput_drop_destroyed_sources(libinput);
+#endif
+		pthread_mutex_destroy(&libinput->config_commands.lock);
+		pthread_mutex_destroy(&libinput->thread.lock);
 		free(libinput->events);
 		close(libinput->epoll_fd);
 		return -1;
@@ -1548,6 +2121,79 @@ libinput_init(struct libinput *libinput,
 	return 0;
 }
 
+/* Commands queued before the dispatch are applied between two sources,
+ * i.e. between two device frames */
+static void
+libinput_config_commands_dispatch(void *data)
+{
+	struct libinput *libinput = data;
+	struct config_command *command, *tmp;
+	struct list commands;
+	uint64_t completed = 0;
+	int fd;
+
+	eventfd_clear(libinput->config_commands.queue_fd);
+
+	list_init(&commands);
+	pthread_mutex_lock(&libinput->config_commands.lock);
+	list_for_each_safe(command, tmp,
+			   &libinput->config_commands.queue,
+			   link) {
+		list_remove(&command->link);
+		list_insert(commands.prev, &command->link);
+	}
+	pthread_mutex_unlock(&libinput->config_commands.lock);
+
+	list_for_each_safe(command, tmp, &commands, link) {
+		command->apply(libinput, command->data);
+		completed = command->serial;
+		free(command);
+	}
+
+	if (completed == 0)
+		return;
+
+	__atomic_store_n(&libinput->config_commands.completed,
+			 completed,
+			 __ATOMIC_RELEASE);
+
+	pthread_mutex_lock(&libinput->config_commands.lock);
+	fd = libinput->config_commands.completion_fd;
+	pthread_mutex_unlock(&libinput->config_commands.lock);
+
+	if (fd != -1)
+		eventfd_write(fd, 1);
+}
+
+/* Commands still queued are not applied, their discard function gets
+ * to release the data instead. Called while the devices still exist. */
+static void
+libinput_config_commands_discard(struct libinput *libinput)
+{
+	struct config_command *command, *tmp;
+
+	list_for_each_safe(command, tmp,
+			   &libinput->config_commands.queue,
+			   link) {
+		list_remove(&command->link);
+		if (command->discard)
+			command->discard(libinput, command->data);
+		free(command);
+	}
+}
+
+static void
+libinput_config_commands_destroy(struct libinput *libinput)
+{
+	if (libinput->config_commands.source)
+		libinput_remove_source(libinput,
+				       libinput->config_commands.source);
+	if (libinput->config_commands.queue_fd != -1)
+		close(libinput->config_commands.queue_fd);
+	if (libinput->config_commands.completion_fd != -1)
+		close(libinput->config_commands.completion_fd);
+}
+
 static void
 libinput_device_destroy(struct libinput_device *device);
 
@@ -1571,70 +2217,310 @@ libinput_ref(struct libinput *libinput)
 	return libinput;
 }
 
-LIBINPUT_EXPORT struct libinput *
-libinput_unref(struct libinput *libinput)
+#if HAVE_LIBWACOM
+/* The libwacom database is expensive to load, so it is loaded once per
+ * context, shared by all devices and kept until the context is
+ * destroyed. A failure is not retried. */
+WacomDeviceDatabase *
+libinput_libwacom_get_db(struct libinput *libinput)
 {
-	struct libinput_event *event;
-	struct libinput_device *device, *next_device;
-	struct libinput_seat *seat, *next_seat;
-	struct libinput_tablet_tool *tool, *next_tool;
-	struct libinput_device_group *group, *next_group;
+	if (libinput->libwacom.db || libinput->libwacom.failed)
+		return libinput->libwacom.db;
 
-	if (libinput == NULL)
-		return NULL;
+	libinput->libwacom.db = libwacom_database_new();
+	if (!libinput->libwacom.db) {
+		log_info(libinput, "Failed to initialize libwacom context.\n");
+		libinput->libwacom.failed = true;
+	}
 
-	assert(libinput->refcount > 0);
-	libinput->refcount--;
-	if (libinput->refcount > 0)
-		return libinput;
+	return libinput->libwacom.db;
+}
+#endif
 
-	libinput_suspend(libinput);
+LIBINPUT_EXPORT int
+libinput_preload_tablet_database(struct libinput *libinput)
+{
+#if HAVE_LIBWACOM
+	return libinput_libwacom_get_db(libinput) ? 0 : -ENOENT;
+#else
+	return -ENOTSUP;
+#endif
+}
 
-	libinput->interface_backend->destroy(libinput);
+static inline size_t
+tablet_tool_bucket(struct libinput *libinput,
+		   enum libinput_tablet_tool_type type,
+		   uint32_t serial)
+{
+	uint32_t hash;
 
-	while ((event = libinput_get_event(libinput)))
-	       libinput_event_destroy(event);
+	/* serials are usually handed out sequentially, multiplicative
+	 * hashing spreads them across the buckets */
+	hash = (serial ^ ((uint32_t)type << 24)) * 2654435761U;
 
-	free(libinput->events);
+	return hash & (libinput->tools.nbuckets - 1);
+}
 
-	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
-		list_for_each_safe(device, next_device,
-				   &seat->devices_list,
-				   link)
-			libinput_device_destroy(device);
+struct libinput_tablet_tool *
+libinput_tablet_tool_find(struct libinput *libinput,
+			  enum libinput_tablet_tool_type type,
+			  uint32_t serial)
+{
+	struct libinput_tablet_tool *tool;
+	struct list *bucket;
 
-		libinput_seat_destroy(seat);
+	if (libinput->tools.nbuckets == 0)
+		return NULL;
+
+	bucket = &libinput->tools.buckets[tablet_tool_bucket(libinput,
+							     type,
+							     serial)];
+	list_for_each(tool, bucket, link) {
+		if (tool->type == type && tool->serial == serial)
+			return tool;
 	}
 
-	list_for_each_safe(group,
-			   next_group,
+	return NULL;
+}
+
+static int
+tablet_tool_rehash(struct libinput *libinput, size_t nbuckets)
+{
+	struct libinput_tablet_tool *tool, *tmp;
+	struct list *old_buckets = libinput->tools.buckets;
+	size_t old_nbuckets = libinput->tools.nbuckets;
+	struct list *buckets;
+	size_t i, idx;
+
+	buckets = zalloc(nbuckets * sizeof(*buckets));
+	if (!buckets)
+		return -ENOMEM;
+
+	for (i = 0; i < nbuckets; i++)
+		list_init(&buckets[i]);
+
+	libinput->tools.buckets = buckets;
+	libinput->tools.nbuckets = nbuckets;
+
+	for (i = 0; i < old_nbuckets; i++) {
+		list_for_each_safe(tool, tmp, &old_buckets[i], link) {
+			idx = tablet_tool_bucket(libinput,
+						 tool->type,
+						 tool->serial);
+			list_remove(&tool->link);
+			list_insert(&buckets[idx], &tool->link);
+		}
+	}
+
+	free(old_buckets);
+
+	return 0;
+}
+
+int
+libinput_tablet_tool_add(struct libinput *libinput,
+			 struct libinput_tablet_tool *tool)
+{
+	size_t idx;
+
+	/* Keep the load factor at or below 1. If growing fails, the
+	 * chains just get a bit longer */
+	if (libinput->tools.ntools >= libinput->tools.nbuckets &&
+	    tablet_tool_rehash(libinput,
+			       max(libinput->tools.nbuckets * 2, 16)) != 0 &&
+	    libinput->tools.nbuckets == 0)
+		return -ENOMEM;
+
+	idx = tablet_tool_bucket(libinput, tool->type, tool->serial);
+	list_insert(&libinput->tools.buckets[idx], &tool->link);
+	libinput->tools.ntools++;
+
+	return 0;
+}
+
+/* True if the calling thread holds the lock through
+ * libinput_dispatch_thread_lock() */
+static inline bool
+libinput_thread_lock_held(struct libinput *libinput)
+{
+	return __atomic_load_n(&libinput->thread.caller_locked,
+			       __ATOMIC_ACQUIRE) &&
+	       pthread_equal(libinput->thread.lock_owner, pthread_self());
+}
+
+LIBINPUT_EXPORT struct libinput *
+libinput_unref(struct libinput *libinput)
+{
+	struct libinput_event *event;
+	struct libinput_device *device, *next_device;
+	struct libinput_seat *seat, *next_seat;
+	struct libinput_tablet_tool *tool, *next_tool;
+	struct libinput_device_group *group, *next_group;
+	size_t i;
+
+	if (libinput == NULL)
+		return NULL;
+
+	assert(libinput->refcount > 0);
+	libinput->refcount--;
+	if (libinput->refcount > 0)
+		return libinput;
+
+	/* destroying a locked mutex is undefined */
+	assert(!libinput_thread_lock_held(libinput));
+
+	libinput_dispatch_thread_stop(libinput);
+	libinput_config_commands_discard(libinput);
+	libinput_suspend(libinput);
+
+	libinput->interface_backend->destroy(libinput);
+
+	while ((event = libinput_get_event(libinput)))
+	       libinput_event_destroy(event);
+
+	free(libinput->events);
+
+	list_for_each_safe(seat, next_seat, &libinput->seat_list, link) {
+		list_for_each_safe(device, next_device,
+				   &seat->devices_list,
+				   link)
+			libinput_device_destroy(device);
+
+		libinput_seat_destroy(seat);
+	}
+
+	list_for_each_safe(group,
+			   next_group,
 			   &libinput->device_group_list,
 			   link) {
 		libinput_device_group_destroy(group);
 	}
 
-	list_for_each_safe(tool, next_tool, &libinput->tool_list, link) {
-		libinput_tablet_tool_unref(tool);
+	for (i = 0; i < libinput->tools.nbuckets; i++) {
+		list_for_each_safe(tool,
+				   next_tool,
+				   &libinput->tools.buckets[i],
+				   link)
+			libinput_tablet_tool_unref(tool);
 	}
+	free(libinput->tools.buckets);
 
 	libinput_timer_subsys_destroy(libinput);
+#if HAVE_LIBWACOM
+	if (libinput->libwacom.db)
+		libwacom_database_destroy(libinput->libwacom.db);
+#endif
+#if HAVE_IO_URING
+	libinput_uring_destroy(libinput);
+#endif
+	libinput_config_commands_destroy(libinput);
 	libinput_drop_destroyed_sources(libinput);
+	libinput_event_pools_destroy(libinput);
+	pthread_mutex_destroy(&libinput->config_commands.lock);
+	pthread_mutex_destroy(&libinput->thread.lock);
 	close(libinput->epoll_fd);
 	free(libinput);
 
 	return NULL;
 }
 
+static int
+event_spsc_ring_init(struct event_spsc_ring *ring, size_t len)
+{
+	ring->events = zalloc(len * sizeof *ring->events);
+	if (!ring->events)
+		return -ENOMEM;
+
+	ring->len = len;
+	ring->head = 0;
+	ring->tail = 0;
+
+	return 0;
+}
+
+/* Producer side. The release store of the tail publishes the event */
+static bool
+event_spsc_ring_push(struct event_spsc_ring *ring,
+		     struct libinput_event *event)
+{
+	size_t head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	size_t tail = ring->tail;
+
+	if (tail - head == ring->len)
+		return false;
+
+	ring->events[tail & (ring->len - 1)] = event;
+	__atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+
+	return true;
+}
+
+/* Consumer side, returns the oldest event without removing it */
+static struct libinput_event *
+event_spsc_ring_peek(struct event_spsc_ring *ring)
+{
+	size_t tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+	size_t head = ring->head;
+
+	if (head == tail)
+		return NULL;
+
+	return ring->events[head & (ring->len - 1)];
+}
+
+/* Consumer side, removes the event returned by event_spsc_ring_peek() */
+static void
+event_spsc_ring_pop(struct event_spsc_ring *ring)
+{
+	__atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+static void
+event_destroy(struct libinput *libinput, struct libinput_event *event)
+{
+	libinput_device_unref(event->device);
+	event_release(libinput, event);
+}
+
+static void
+libinput_thread_recycle(struct libinput *libinput);
+
 LIBINPUT_EXPORT void
 libinput_event_destroy(struct libinput_event *event)
 {
+	struct libinput *libinput;
+
 	if (event == NULL)
 		return;
 
-	if (event->device)
-		libinput_device_unref(event->device);
+	if (!event->device) {
+		free(event);
+		return;
+	}
+
+	libinput = event->device->seat->libinput;
+
+	/* The device and the event pools belong to the dispatch thread,
+	 * hand the event back unless the ring is full */
+	if (libinput->thread.active) {
+		if (event_spsc_ring_push(&libinput->thread.returned, event))
+			return;
+
+		/* the caller may already hold the lock, it isn't recursive */
+		if (libinput_thread_lock_held(libinput)) {
+			libinput_thread_recycle(libinput);
+			event_destroy(libinput, event);
+			return;
+		}
+
+		pthread_mutex_lock(&libinput->thread.lock);
+		libinput_thread_recycle(libinput);
+		event_destroy(libinput, event);
+		pthread_mutex_unlock(&libinput->thread.lock);
+		return;
+	}
 
-	free(event);
+	event_destroy(libinput, event);
 }
 
 int
@@ -1776,31 +2662,166 @@ libinput_device_unref(struct libinput_device *device)
 LIBINPUT_EXPORT int
 libinput_get_fd(struct libinput *libinput)
 {
+	if (libinput->thread.active)
+		return libinput->thread.event_fd;
+
 	return libinput->epoll_fd;
 }
 
-LIBINPUT_EXPORT int
-libinput_dispatch(struct libinput *libinput)
+static inline bool
+libinput_source_is_priority(struct libinput *libinput,
+			    struct libinput_source *source)
 {
-	struct libinput_source *source;
+	return libinput->dispatch_keyboard_priority &&
+	       source->frame_interface->is_priority(source->user_data);
+}
+
+/* Process the runnable sources one frame at a time until all are done or
+ * the budget is exhausted. Priority sources always go first. Otherwise
+ * the sources take turns in LIBINPUT_DISPATCH_MODE_ROUND_ROBIN, or the
+ * frame with the earliest timestamp goes next in
+ * LIBINPUT_DISPATCH_MODE_TIMESTAMP. */
+static void
+libinput_dispatch_frames(struct libinput *libinput)
+{
+	struct libinput_source *source, *tmp, *next;
+	bool round_robin =
+		libinput->dispatch_mode == LIBINPUT_DISPATCH_MODE_ROUND_ROBIN;
+	bool priority, next_priority = false;
+	uint64_t time, next_time = 0;
+
+	while (!list_empty(&libinput->source_run_list) &&
+	       !libinput_dispatch_budget_exhausted(libinput)) {
+		next = NULL;
+
+		list_for_each_safe(source, tmp,
+				   &libinput->source_run_list,
+				   run_link) {
+			if (!source->frame_interface->peek_frame(source->user_data,
+								 &time)) {
+				libinput_source_set_runnable(libinput,
+							     source,
+							     false);
+				continue;
+			}
+
+			priority = libinput_source_is_priority(libinput,
+							       source);
+			if (next &&
+			    (next_priority > priority ||
+			     (next_priority == priority &&
+			      (round_robin || next_time <= time))))
+				continue;
+
+			next = source;
+			next_time = time;
+			next_priority = priority;
+
+			/* nothing later in the list can beat it */
+			if (round_robin &&
+			    (priority || !libinput->dispatch_keyboard_priority))
+				break;
+		}
+
+		if (!next)
+			break;
+
+		next->frame_interface->dispatch_frame(next->user_data);
+
+		/* back of the queue, for ties in timestamp mode too */
+		if (next->runnable) {
+			list_remove(&next->run_link);
+			list_insert(libinput->source_run_list.prev,
+				    &next->run_link);
+		}
+	}
+
+	/* Leftovers are picked up through epoll or the pending list */
+	list_for_each_safe(source, tmp, &libinput->source_run_list, run_link)
+		libinput_source_set_runnable(libinput, source, false);
+}
+
+static inline void
+libinput_dispatch_source(struct libinput *libinput,
+			 struct libinput_source *source)
+{
+	if (source->fd == -1)
+		return;
+
+	if (libinput->dispatch_mode != LIBINPUT_DISPATCH_MODE_DRAIN &&
+	    source->frame_interface)
+		libinput_source_set_runnable(libinput, source, true);
+	else
+		source->dispatch(source->user_data);
+}
+
+static int
+libinput_dispatch_sources(struct libinput *libinput,
+			  uint64_t max_us,
+			  size_t max_events)
+{
+	struct libinput_dispatch_budget *budget = &libinput->dispatch_budget;
+	struct libinput_source *source, *tmp;
 	struct epoll_event ep[32];
-	int i, count;
+	int i, count, rc;
+
+	budget->deadline = max_us ? libinput_now(libinput) + max_us : 0;
+	budget->events_left = max_events ? max_events : SIZE_MAX;
+	budget->exhausted = false;
+
+	/* Buffered input is older than anything epoll reports */
+	list_for_each_safe(source, tmp,
+			   &libinput->source_pending_list,
+			   pending_link)
+		libinput_dispatch_source(libinput, source);
 
 	count = epoll_wait(libinput->epoll_fd, ep, ARRAY_LENGTH(ep), 0);
-	if (count < 0)
-		return -errno;
+	rc = count < 0 ? -errno : 0;
 
-	for (i = 0; i < count; ++i) {
-		source = ep[i].data.ptr;
-		if (source->fd == -1)
-			continue;
+	for (i = 0; i < count; ++i)
+		libinput_dispatch_source(libinput, ep[i].data.ptr);
 
-		source->dispatch(source->user_data);
-	}
+	libinput_dispatch_frames(libinput);
+
+#if HAVE_IO_URING
+	if (libinput->uring.active)
+		libinput_uring_rearm(libinput);
+#endif
 
 	libinput_drop_destroyed_sources(libinput);
 
-	return 0;
+	return rc;
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch(struct libinput *libinput)
+{
+	if (libinput->thread.active) {
+		eventfd_clear(libinput->thread.event_fd);
+		return 0;
+	}
+
+	return libinput_dispatch_sources(libinput, 0, 0);
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_budget(struct libinput *libinput,
+			 uint64_t max_us,
+			 size_t max_events)
+{
+	int rc;
+
+	if (libinput->thread.active) {
+		eventfd_clear(libinput->thread.event_fd);
+		return 0;
+	}
+
+	rc = libinput_dispatch_sources(libinput, max_us, max_events);
+	if (rc < 0)
+		return rc;
+
+	return libinput->dispatch_budget.exhausted ||
+	       !list_empty(&libinput->source_pending_list);
 }
 
 void
@@ -1865,13 +2886,87 @@ update_seat_button_count(struct libinput_seat *seat,
 	return 0;
 }
 
+/* Returns the index of the event type in the per-type counters, or -1
+ * for an invalid event type */
+static inline int
+event_type_index(enum libinput_event_type type)
+{
+	switch (type) {
+	case LIBINPUT_EVENT_KEYBOARD_KEY:		return 0;
+	case LIBINPUT_EVENT_POINTER_MOTION:		return 1;
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:	return 2;
+	case LIBINPUT_EVENT_POINTER_BUTTON:		return 3;
+	case LIBINPUT_EVENT_POINTER_AXIS:		return 4;
+	case LIBINPUT_EVENT_TOUCH_DOWN:			return 5;
+	case LIBINPUT_EVENT_TOUCH_UP:			return 6;
+	case LIBINPUT_EVENT_TOUCH_MOTION:		return 7;
+	case LIBINPUT_EVENT_TOUCH_CANCEL:		return 8;
+	case LIBINPUT_EVENT_TOUCH_FRAME:		return 9;
+	case LIBINPUT_EVENT_TABLET_TOOL_AXIS:		return 10;
+	case LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY:	return 11;
+	case LIBINPUT_EVENT_TABLET_TOOL_TIP:		return 12;
+	case LIBINPUT_EVENT_TABLET_TOOL_BUTTON:		return 13;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_BEGIN:	return 14;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_UPDATE:	return 15;
+	case LIBINPUT_EVENT_GESTURE_SWIPE_END:		return 16;
+	case LIBINPUT_EVENT_GESTURE_PINCH_BEGIN:	return 17;
+	case LIBINPUT_EVENT_GESTURE_PINCH_UPDATE:	return 18;
+	case LIBINPUT_EVENT_GESTURE_PINCH_END:		return 19;
+	case LIBINPUT_EVENT_DEVICE_ADDED:		return 20;
+	case LIBINPUT_EVENT_DEVICE_REMOVED:		return 21;
+	default:
+		return -1;
+	}
+}
+
+/* Returns the bit for the event type in the subscription masks, or 0 for
+ * event types that cannot be unsubscribed from */
+static inline uint32_t
+event_type_subscription_bit(enum libinput_event_type type)
+{
+	int idx;
+
+	if (type == LIBINPUT_EVENT_DEVICE_ADDED ||
+	    type == LIBINPUT_EVENT_DEVICE_REMOVED)
+		return 0;
+
+	idx = event_type_index(type);
+	if (idx < 0)
+		return 0;
+
+	return 1U << idx;
+}
+
+static inline bool
+event_type_is_subscribed(struct libinput_device *device,
+			 enum libinput_event_type type)
+{
+	uint32_t unsubscribed = device->seat->libinput->events_unsubscribed |
+				device->events_unsubscribed;
+
+	return (unsubscribed & event_type_subscription_bit(type)) == 0;
+}
+
+/* An event that nobody subscribed to still needs to be created if an
+ * internal listener (e.g. disable-while-typing) is attached to the
+ * device. It is discarded after the listeners were notified. */
+static inline bool
+event_type_is_wanted(struct libinput_device *device,
+		     enum libinput_event_type type)
+{
+	return !list_empty(&device->event_listeners) ||
+		event_type_is_subscribed(device, type);
+}
+
 static void
 init_event_base(struct libinput_event *event,
 		struct libinput_device *device,
+		uint64_t time,
 		enum libinput_event_type type)
 {
 	event->type = type;
 	event->device = device;
+	event->time = time;
 }
 
 static void
@@ -1880,7 +2975,7 @@ post_base_event(struct libinput_device *device,
 		struct libinput_event *event)
 {
 	struct libinput *libinput = device->seat->libinput;
-	init_event_base(event, device, type);
+	init_event_base(event, device, 0, type);
 	libinput_post_event(libinput, event);
 }
 
@@ -1892,11 +2987,16 @@ post_device_event(struct libinput_device *device,
 {
 	struct libinput_event_listener *listener, *tmp;
 
-	init_event_base(event, device, type);
+	init_event_base(event, device, time, type);
 
 	list_for_each_safe(listener, tmp, &device->event_listeners, link)
 		listener->notify_func(time, event, listener->notify_func_data);
 
+	if (!event_type_is_subscribed(device, type)) {
+		event_release(device->seat->libinput, event);
+		return;
+	}
+
 	libinput_post_event(device->seat->libinput, event);
 }
 
@@ -1905,7 +3005,7 @@ notify_added_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *added_device_event;
 
-	added_device_event = zalloc(sizeof *added_device_event);
+	added_device_event = event_alloc(device, EVENT_POOL_DEVICE_NOTIFY);
 	if (!added_device_event)
 		return;
 
@@ -1919,7 +3019,7 @@ notify_removed_device(struct libinput_device *device)
 {
 	struct libinput_event_device_notify *removed_device_event;
 
-	removed_device_event = zalloc(sizeof *removed_device_event);
+	removed_device_event = event_alloc(device, EVENT_POOL_DEVICE_NOTIFY);
 	if (!removed_device_event)
 		return;
 
@@ -1975,11 +3075,14 @@ keyboard_notify_key(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_KEYBOARD))
 		return;
 
-	key_event = zalloc(sizeof *key_event);
-	if (!key_event)
+	seat_key_count = update_seat_key_count(device->seat, key, state);
+
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_KEYBOARD_KEY))
 		return;
 
-	seat_key_count = update_seat_key_count(device->seat, key, state);
+	key_event = event_alloc(device, EVENT_POOL_KEYBOARD);
+	if (!key_event)
+		return;
 
 	*key_event = (struct libinput_event_keyboard) {
 		.time = time,
@@ -2004,7 +3107,10 @@ pointer_notify_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_event = zalloc(sizeof *motion_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_POINTER_MOTION))
+		return;
+
+	motion_event = event_alloc(device, EVENT_POOL_POINTER);
 	if (!motion_event)
 		return;
 
@@ -2029,7 +3135,10 @@ pointer_notify_motion_absolute(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	motion_absolute_event = zalloc(sizeof *motion_absolute_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE))
+		return;
+
+	motion_absolute_event = event_alloc(device, EVENT_POOL_POINTER);
 	if (!motion_absolute_event)
 		return;
 
@@ -2055,14 +3164,17 @@ pointer_notify_button(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_POINTER_BUTTON))
+		return;
+
+	button_event = event_alloc(device, EVENT_POOL_POINTER);
+	if (!button_event)
+		return;
+
 	*button_event = (struct libinput_event_pointer) {
 		.time = time,
 		.button = button,
@@ -2088,7 +3200,10 @@ pointer_notify_axis(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_POINTER))
 		return;
 
-	axis_event = zalloc(sizeof *axis_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_POINTER_AXIS))
+		return;
+
+	axis_event = event_alloc(device, EVENT_POOL_POINTER);
 	if (!axis_event)
 		return;
 
@@ -2117,7 +3232,10 @@ touch_notify_touch_down(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TOUCH_DOWN))
+		return;
+
+	touch_event = event_alloc(device, EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -2145,7 +3263,10 @@ touch_notify_touch_motion(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TOUCH_MOTION))
+		return;
+
+	touch_event = event_alloc(device, EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -2172,7 +3293,10 @@ touch_notify_touch_up(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TOUCH_UP))
+		return;
+
+	touch_event = event_alloc(device, EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -2196,7 +3320,10 @@ touch_notify_frame(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_TOUCH))
 		return;
 
-	touch_event = zalloc(sizeof *touch_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TOUCH_FRAME))
+		return;
+
+	touch_event = event_alloc(device, EVENT_POOL_TOUCH);
 	if (!touch_event)
 		return;
 
@@ -2219,7 +3346,10 @@ tablet_notify_axis(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *axis_event;
 
-	axis_event = zalloc(sizeof *axis_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TABLET_TOOL_AXIS))
+		return;
+
+	axis_event = event_alloc(device, EVENT_POOL_TABLET_TOOL);
 	if (!axis_event)
 		return;
 
@@ -2251,7 +3381,10 @@ tablet_notify_proximity(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *proximity_event;
 
-	proximity_event = zalloc(sizeof *proximity_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY))
+		return;
+
+	proximity_event = event_alloc(device, EVENT_POOL_TABLET_TOOL);
 	if (!proximity_event)
 		return;
 
@@ -2282,7 +3415,10 @@ tablet_notify_tip(struct libinput_device *device,
 {
 	struct libinput_event_tablet_tool *tip_event;
 
-	tip_event = zalloc(sizeof *tip_event);
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TABLET_TOOL_TIP))
+		return;
+
+	tip_event = event_alloc(device, EVENT_POOL_TABLET_TOOL);
 	if (!tip_event)
 		return;
 
@@ -2315,14 +3451,17 @@ tablet_notify_button(struct libinput_device *device,
 	struct libinput_event_tablet_tool *button_event;
 	int32_t seat_button_count;
 
-	button_event = zalloc(sizeof *button_event);
-	if (!button_event)
-		return;
-
 	seat_button_count = update_seat_button_count(device->seat,
 						     button,
 						     state);
 
+	if (!event_type_is_wanted(device, LIBINPUT_EVENT_TABLET_TOOL_BUTTON))
+		return;
+
+	button_event = event_alloc(device, EVENT_POOL_TABLET_TOOL);
+	if (!button_event)
+		return;
+
 	*button_event = (struct libinput_event_tablet_tool) {
 		.time = time,
 		.tool = tool,
@@ -2356,7 +3495,10 @@ gesture_notify(struct libinput_device *device,
 	if (!device_has_cap(device, LIBINPUT_DEVICE_CAP_GESTURE))
 		return;
 
-	gesture_event = zalloc(sizeof *gesture_event);
+	if (!event_type_is_wanted(device, type))
+		return;
+
+	gesture_event = event_alloc(device, EVENT_POOL_GESTURE);
 	if (!gesture_event)
 		return;
 
@@ -2458,76 +3600,472 @@ event_type_to_str(enum libinput_event_type type)
 	return NULL;
 }
 
-static void
-libinput_post_event(struct libinput *libinput,
-		    struct libinput_event *event)
+static inline struct libinput_event **
+event_queue_at(struct libinput *libinput, size_t idx)
 {
-	struct libinput_event **events = libinput->events;
-	size_t events_len = libinput->events_len;
-	size_t events_count = libinput->events_count;
-	size_t move_len;
-	size_t new_out;
+	return &libinput->events[(libinput->events_out + idx) &
+				 (libinput->events_len - 1)];
+}
 
-#if 0
-	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
-#endif
+static int
+event_queue_resize(struct libinput *libinput, size_t events_len)
+{
+	struct libinput_event **events;
+	size_t count = libinput->events_count;
+	size_t first;
 
-	events_count++;
-	if (events_count > events_len) {
-		events_len *= 2;
-		events = realloc(events, events_len * sizeof *events);
-		if (!events) {
-			log_error(libinput,
-				  "Failed to reallocate event ring buffer. "
-				  "Events may be discarded\n");
-			return;
-		}
+	assert(events_len >= count);
+	assert((events_len & (events_len - 1)) == 0);
 
-		if (libinput->events_count > 0 && libinput->events_in == 0) {
-			libinput->events_in = libinput->events_len;
-		} else if (libinput->events_count > 0 &&
-			   libinput->events_out >= libinput->events_in) {
-			move_len = libinput->events_len - libinput->events_out;
-			new_out = events_len - move_len;
-			memmove(events + new_out,
-				events + libinput->events_out,
-				move_len * sizeof *events);
-			libinput->events_out = new_out;
-		}
+	events = zalloc(events_len * sizeof *events);
+	if (!events)
+		return -ENOMEM;
 
-		libinput->events = events;
-		libinput->events_len = events_len;
-	}
+	/* unwrap the ring so the oldest event is at index 0 */
+	first = min(count, libinput->events_len - libinput->events_out);
+	memcpy(events,
+	       &libinput->events[libinput->events_out],
+	       first * sizeof *events);
+	memcpy(&events[first],
+	       libinput->events,
+	       (count - first) * sizeof *events);
 
-	if (event->device)
-		libinput_device_ref(event->device);
+	free(libinput->events);
+	libinput->events = events;
+	libinput->events_len = events_len;
+	libinput->events_out = 0;
+	libinput->events_in = count & (events_len - 1);
 
-	libinput->events_count = events_count;
-	events[libinput->events_in] = event;
-	libinput->events_in = (libinput->events_in + 1) % libinput->events_len;
+	return 0;
 }
 
-LIBINPUT_EXPORT struct libinput_event *
-libinput_get_event(struct libinput *libinput)
+static inline bool
+event_is_pointer_motion(struct libinput_event *event)
 {
-	struct libinput_event *event;
-
+	switch (event->type) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+	case LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE:
+		return true;
+	default:
+		return false;
+	}
+}
+
+/* Merge a relative motion event into the given queued relative motion
+ * event. The deltas are summed, the timestamp is that of the more recent
+ * event, both in the pointer event and in the base event the latency is
+ * measured from. */
+static void
+event_merge_motion(struct libinput_event *queued,
+		   struct libinput_event *event)
+{
+	struct libinput_event_pointer *dest, *src;
+
+	dest = (struct libinput_event_pointer *)queued;
+	src = (struct libinput_event_pointer *)event;
+
+	queued->time = event->time;
+	dest->time = src->time;
+	dest->delta.x += src->delta.x;
+	dest->delta.y += src->delta.y;
+	dest->delta_raw.x += src->delta_raw.x;
+	dest->delta_raw.y += src->delta_raw.y;
+}
+
+/* Merge the relative motion event into the tail of the queue if the tail
+ * is a relative motion event from the same device. Returns true if the
+ * event was merged and released, false otherwise. */
+static bool
+event_queue_coalesce_tail(struct libinput *libinput,
+			  struct libinput_event *event)
+{
+	struct libinput_event *tail;
+
+	if (libinput->events_count == 0 ||
+	    event->type != LIBINPUT_EVENT_POINTER_MOTION)
+		return false;
+
+	tail = *event_queue_at(libinput, libinput->events_count - 1);
+	if (tail->device != event->device ||
+	    tail->type != LIBINPUT_EVENT_POINTER_MOTION)
+		return false;
+
+	event_merge_motion(tail, event);
+	event_release(libinput, event);
+	libinput->events_coalesced++;
+
+	return true;
+}
+
+/* Drop the oldest queued pointer motion event, or the new event itself
+ * if it is a pointer motion event and nothing older can be dropped.
+ * Touch motion and tablet axis events are part of a frame (or a
+ * proximity/tip sequence) and are never dropped. Returns true if the
+ * new event was dropped, false if the event still needs to be queued. If
+ * nothing could be dropped, the queue remains full. */
+static bool
+event_queue_drop_motion(struct libinput *libinput,
+			struct libinput_event *event)
+{
+	struct libinput_event *queued;
+	size_t idx;
+
+	for (idx = 0; idx < libinput->events_count; idx++) {
+		queued = *event_queue_at(libinput, idx);
+		if (!event_is_pointer_motion(queued))
+			continue;
+
+		for (; idx < libinput->events_count - 1; idx++)
+			*event_queue_at(libinput, idx) =
+				*event_queue_at(libinput, idx + 1);
+
+		libinput->events_count--;
+		libinput->events_in = (libinput->events_in - 1) &
+				      (libinput->events_len - 1);
+		libinput->events_dropped++;
+		event_destroy(libinput, queued);
+		return false;
+	}
+
+	if (event_is_pointer_motion(event)) {
+		libinput->events_dropped++;
+		event_release(libinput, event);
+		return true;
+	}
+
+	return false;
+}
+
+static void
+libinput_post_event(struct libinput *libinput,
+		    struct libinput_event *event)
+{
+#if 0
+	log_debug(libinput, "Queuing %s\n", event_type_to_str(event->type));
+#endif
+
+	counter_inc(libinput->events_posted[event_type_index(event->type)]);
+
+	if (libinput->events_coalesce_motion &&
+	    event_queue_coalesce_tail(libinput, event))
+		return;
+
+	if (libinput->events_count == libinput->events_len) {
+		switch (libinput->events_overflow) {
+		case LIBINPUT_EVENT_QUEUE_OVERFLOW_COALESCE:
+			/* Only the tail, merging into an earlier event
+			 * would put the new timestamp ahead of events
+			 * other devices sent before it */
+			if (event_queue_coalesce_tail(libinput, event))
+				return;
+			/* fallthrough */
+		case LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION:
+			if (event_queue_drop_motion(libinput, event))
+				return;
+			break;
+		case LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW:
+			break;
+		}
+	}
+
+	if (libinput->events_count == libinput->events_len) {
+		if (event_queue_resize(libinput,
+				       libinput->events_len * 2) != 0) {
+			log_error(libinput,
+				  "Failed to reallocate event ring buffer. "
+				  "Events may be discarded\n");
+			libinput->events_dropped++;
+			event_release(libinput, event);
+			return;
+		}
+		counter_inc(libinput->events_grown);
+	}
+
+	if (event->device)
+		libinput_device_ref(event->device);
+
+	libinput->events[libinput->events_in] = event;
+	libinput->events_in = (libinput->events_in + 1) &
+			      (libinput->events_len - 1);
+	libinput->events_count++;
+
+	if (libinput->events_count > libinput->events_high_watermark)
+		libinput->events_high_watermark = libinput->events_count;
+}
+
+static inline unsigned int
+latency_histogram_bucket(uint64_t latency)
+{
+	unsigned int bucket;
+
+	if (latency < 2)
+		return 0;
+
+	bucket = 63 - __builtin_clzll(latency);
+
+	return min(bucket, LATENCY_HISTOGRAM_BUCKETS - 1);
+}
+
+static void
+event_record_latency(struct libinput_event *event, uint64_t now)
+{
+	uint64_t latency;
+
+	if (event->time == 0 || event->device == NULL)
+		return;
+
+	/* a timestamp in the future is a clock mismatch, not a negative
+	 * latency */
+	latency = now > event->time ? now - event->time : 0;
+	event->device->latency_histogram[latency_histogram_bucket(latency)]++;
+}
+
+static struct libinput_event *
+event_queue_pop(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
 	if (libinput->events_count == 0)
 		return NULL;
 
 	event = libinput->events[libinput->events_out];
 	libinput->events_out =
-		(libinput->events_out + 1) % libinput->events_len;
+		(libinput->events_out + 1) & (libinput->events_len - 1);
 	libinput->events_count--;
 
 	return event;
 }
 
+static struct libinput_event *
+libinput_thread_consume(struct libinput *libinput);
+
+LIBINPUT_EXPORT struct libinput_event *
+libinput_get_event(struct libinput *libinput)
+{
+	struct libinput_event *event;
+
+	if (libinput->thread.active)
+		event = libinput_thread_consume(libinput);
+	else
+		event = event_queue_pop(libinput);
+
+	if (event && libinput->latency_histogram_enabled)
+		event_record_latency(event, libinput_now(libinput));
+
+	return event;
+}
+
+static size_t
+event_queue_pop_events(struct libinput *libinput,
+		       struct libinput_event **events,
+		       size_t max_events)
+{
+	size_t count, first;
+
+	count = min(max_events, libinput->events_count);
+	if (count == 0)
+		return 0;
+
+	/* The ring wraps at most once, so this is at most two copies */
+	first = min(count, libinput->events_len - libinput->events_out);
+	memcpy(events,
+	       &libinput->events[libinput->events_out],
+	       first * sizeof *events);
+	if (count > first)
+		memcpy(&events[first],
+		       libinput->events,
+		       (count - first) * sizeof *events);
+
+	libinput->events_out =
+		(libinput->events_out + count) & (libinput->events_len - 1);
+	libinput->events_count -= count;
+
+	return count;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events)
+{
+	size_t count = 0;
+
+	if (libinput->thread.active) {
+		while (count < max_events &&
+		       (events[count] = libinput_thread_consume(libinput)))
+			count++;
+	} else {
+		count = event_queue_pop_events(libinput, events, max_events);
+	}
+
+	if (count > 0 && libinput->latency_histogram_enabled) {
+		uint64_t now = libinput_now(libinput);
+		size_t i;
+
+		for (i = 0; i < count; i++)
+			event_record_latency(events[i], now);
+	}
+
+	return count;
+}
+
+LIBINPUT_EXPORT void
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents)
+{
+	size_t i;
+
+	for (i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
+}
+
+LIBINPUT_EXPORT int
+libinput_event_queue_set_capacity(struct libinput *libinput,
+				  size_t capacity)
+{
+	size_t events_len = 4;
+
+	if (capacity == 0 || capacity > SIZE_MAX / 2)
+		return -EINVAL;
+
+	while (events_len < capacity)
+		events_len *= 2;
+
+	if (events_len < libinput->events_count)
+		return -EBUSY;
+
+	if (events_len == libinput->events_len)
+		return 0;
+
+	return event_queue_resize(libinput, events_len);
+}
+
+LIBINPUT_EXPORT size_t
+libinput_event_queue_get_capacity(struct libinput *libinput)
+{
+	return libinput->events_len;
+}
+
+LIBINPUT_EXPORT int
+libinput_event_queue_set_overflow_policy(struct libinput *libinput,
+					 enum libinput_event_queue_overflow policy)
+{
+	switch (policy) {
+	case LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW:
+	case LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION:
+	case LIBINPUT_EVENT_QUEUE_OVERFLOW_COALESCE:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	libinput->events_overflow = policy;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_event_queue_overflow
+libinput_event_queue_get_overflow_policy(struct libinput *libinput)
+{
+	return libinput->events_overflow;
+}
+
+LIBINPUT_EXPORT void
+libinput_event_queue_set_coalesce_motion(struct libinput *libinput,
+					 int enable)
+{
+	libinput->events_coalesce_motion = !!enable;
+}
+
+LIBINPUT_EXPORT int
+libinput_event_queue_get_coalesce_motion(struct libinput *libinput)
+{
+	return libinput->events_coalesce_motion;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_event_queue_get_high_watermark(struct libinput *libinput)
+{
+	return libinput->events_high_watermark;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_queue_get_dropped_count(struct libinput *libinput)
+{
+	return libinput->events_dropped;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_event_queue_get_coalesced_count(struct libinput *libinput)
+{
+	return libinput->events_coalesced;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_counter(struct libinput *libinput,
+		     enum libinput_counter counter)
+{
+	uint64_t value = 0;
+	unsigned int i;
+
+	switch (counter) {
+	case LIBINPUT_COUNTER_EVENTS_POSTED:
+		for (i = 0; i < EVENT_TYPE_COUNT; i++)
+			value += counter_read(libinput->events_posted[i]);
+		break;
+	case LIBINPUT_COUNTER_EVENTS_COALESCED:
+		value = libinput->events_coalesced;
+		break;
+	case LIBINPUT_COUNTER_EVENTS_DROPPED:
+		value = libinput->events_dropped;
+		break;
+	case LIBINPUT_COUNTER_EVENT_QUEUE_GROWN:
+		value = counter_read(libinput->events_grown);
+		break;
+	case LIBINPUT_COUNTER_EVENT_POOL_HITS:
+		for (i = 0; i < EVENT_POOL_COUNT; i++)
+			value += libinput->event_pools[i].hits;
+		break;
+	case LIBINPUT_COUNTER_EVENT_POOL_MISSES:
+		for (i = 0; i < EVENT_POOL_COUNT; i++)
+			value += libinput->event_pools[i].misses;
+		break;
+	case LIBINPUT_COUNTER_TIMER_ARMED:
+		value = counter_read(libinput->timer.armed);
+		break;
+	case LIBINPUT_COUNTER_TIMER_FIRED:
+		value = counter_read(libinput->timer.fired);
+		break;
+	case LIBINPUT_COUNTER_TIMER_SETTIME_SKIPPED:
+		value = libinput->timer.settime_skipped;
+		break;
+	}
+
+	return value;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_event_type_counter(struct libinput *libinput,
+				enum libinput_event_type type)
+{
+	int idx = event_type_index(type);
+
+	if (idx < 0)
+		return 0;
+
+	return counter_read(libinput->events_posted[idx]);
+}
+
 LIBINPUT_EXPORT enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput)
 {
 	struct libinput_event *event;
 
+	if (libinput->thread.active) {
+		event = event_spsc_ring_peek(&libinput->thread.published);
+		return event ? event->type : LIBINPUT_EVENT_NONE;
+	}
+
 	if (libinput->events_count == 0)
 		return LIBINPUT_EVENT_NONE;
 
@@ -2535,6 +4073,426 @@ libinput_next_event_type(struct libinput *libinput)
 	return event->type;
 }
 
+/* Called by the thread with the lock held, or by the caller with the
+ * lock held if the returned ring is full */
+static void
+libinput_thread_recycle(struct libinput *libinput)
+{
+	struct event_spsc_ring *ring = &libinput->thread.returned;
+	struct libinput_event *event;
+
+	while ((event = event_spsc_ring_peek(ring))) {
+		event_spsc_ring_pop(ring);
+		event_destroy(libinput, event);
+	}
+}
+
+/* Move events from the internal queue to the caller. Whatever does not
+ * fit stays in the internal queue, subject to its overflow policy, until
+ * the caller consumed enough to wake us up again. */
+static bool
+libinput_thread_publish(struct libinput *libinput)
+{
+	struct event_spsc_ring *ring = &libinput->thread.published;
+	struct libinput_event *event;
+	bool published = false;
+
+	while (libinput->events_count > 0) {
+		event = libinput->events[libinput->events_out];
+		if (!event_spsc_ring_push(ring, event)) {
+			/* Set the flag before the second attempt, the
+			 * caller may have emptied the ring in between */
+			__atomic_store_n(&libinput->thread.wake_on_consume,
+					 true,
+					 __ATOMIC_SEQ_CST);
+			if (!event_spsc_ring_push(ring, event))
+				break;
+		}
+
+		event_queue_pop(libinput);
+		published = true;
+	}
+
+	return published;
+}
+
+static struct libinput_event *
+libinput_thread_consume(struct libinput *libinput)
+{
+	struct event_spsc_ring *ring = &libinput->thread.published;
+	struct libinput_event *event;
+
+	event = event_spsc_ring_peek(ring);
+	if (!event)
+		return NULL;
+
+	event_spsc_ring_pop(ring);
+
+	if (__atomic_exchange_n(&libinput->thread.wake_on_consume,
+				false,
+				__ATOMIC_SEQ_CST))
+		eventfd_write(libinput->thread.wake_fd, 1);
+
+	return event;
+}
+
+/* Put the events the caller did not retrieve back in front of the
+ * internal queue, they are older than anything queued there */
+static void
+libinput_thread_unpublish(struct libinput *libinput)
+{
+	struct event_spsc_ring *ring = &libinput->thread.published;
+	size_t n = ring->tail - ring->head;
+	size_t events_len = libinput->events_len;
+	size_t i;
+
+	if (n == 0)
+		return;
+
+	while (events_len < libinput->events_count + n)
+		events_len *= 2;
+
+	/* resizing unwraps the ring, the oldest event is at index 0 */
+	if (event_queue_resize(libinput, events_len) != 0) {
+		log_error(libinput,
+			  "Failed to reallocate event ring buffer. "
+			  "Events will be discarded\n");
+		for (i = 0; i < n; i++)
+			event_destroy(libinput,
+				      ring->events[(ring->head + i) &
+						   (ring->len - 1)]);
+		libinput->events_dropped += n;
+		ring->head = ring->tail;
+		return;
+	}
+
+	memmove(&libinput->events[n],
+		libinput->events,
+		libinput->events_count * sizeof *libinput->events);
+	for (i = 0; i < n; i++)
+		libinput->events[i] =
+			ring->events[(ring->head + i) & (ring->len - 1)];
+
+	libinput->events_count += n;
+	libinput->events_in = libinput->events_count & (events_len - 1);
+	ring->head = ring->tail;
+}
+
+static void
+libinput_thread_wake(void *data)
+{
+	struct libinput *libinput = data;
+
+	eventfd_clear(libinput->thread.wake_fd);
+}
+
+static void *
+libinput_thread_func(void *data)
+{
+	struct libinput *libinput = data;
+	struct epoll_event ep;
+	bool published;
+
+	while (!__atomic_load_n(&libinput->thread.stop, __ATOMIC_ACQUIRE)) {
+		/* only used to sleep, libinput_dispatch_sources() collects
+		 * the ready sources itself */
+		if (epoll_wait(libinput->epoll_fd, &ep, 1, -1) < 0 &&
+		    errno != EINTR) {
+			log_error(libinput,
+				  "dispatch thread: epoll_wait failed (%s)\n",
+				  strerror(errno));
+			break;
+		}
+
+		pthread_mutex_lock(&libinput->thread.lock);
+		libinput_thread_recycle(libinput);
+		libinput_dispatch_sources(libinput, 0, 0);
+		published = libinput_thread_publish(libinput);
+		pthread_mutex_unlock(&libinput->thread.lock);
+
+		if (published)
+			eventfd_write(libinput->thread.event_fd, 1);
+	}
+
+	return NULL;
+}
+
+static void
+libinput_thread_cleanup(struct libinput *libinput)
+{
+	if (libinput->thread.wake_source) {
+		libinput_remove_source(libinput, libinput->thread.wake_source);
+		libinput->thread.wake_source = NULL;
+		libinput_drop_destroyed_sources(libinput);
+	}
+	if (libinput->thread.wake_fd != -1)
+		close(libinput->thread.wake_fd);
+	if (libinput->thread.event_fd != -1)
+		close(libinput->thread.event_fd);
+	libinput->thread.wake_fd = -1;
+	libinput->thread.event_fd = -1;
+
+	free(libinput->thread.published.events);
+	free(libinput->thread.returned.events);
+	memset(&libinput->thread.published, 0,
+	       sizeof(libinput->thread.published));
+	memset(&libinput->thread.returned, 0,
+	       sizeof(libinput->thread.returned));
+}
+
+LIBINPUT_EXPORT int
+libinput_dispatch_thread_start(struct libinput *libinput)
+{
+	int rc;
+
+	if (libinput->thread.active)
+		return -EALREADY;
+
+	if (event_spsc_ring_init(&libinput->thread.published,
+				 DISPATCH_THREAD_RING_SIZE) != 0 ||
+	    event_spsc_ring_init(&libinput->thread.returned,
+				 DISPATCH_THREAD_RING_SIZE) != 0) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	libinput->thread.event_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	libinput->thread.wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	if (libinput->thread.event_fd == -1 ||
+	    libinput->thread.wake_fd == -1) {
+		rc = -errno;
+		goto err;
+	}
+
+	libinput->thread.wake_source = libinput_add_fd(libinput,
+						       libinput->thread.wake_fd,
+						       libinput_thread_wake,
+						       libinput);
+	if (!libinput->thread.wake_source) {
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	/* anything already queued is handed over right away */
+	if (libinput_thread_publish(libinput))
+		eventfd_write(libinput->thread.event_fd, 1);
+
+	libinput->thread.stop = false;
+	libinput->thread.active = true;
+
+	rc = -pthread_create(&libinput->thread.thread,
+			     NULL,
+			     libinput_thread_func,
+			     libinput);
+	if (rc != 0) {
+		libinput->thread.active = false;
+		libinput_thread_unpublish(libinput);
+		goto err;
+	}
+
+	return 0;
+
+err:
+	libinput_thread_cleanup(libinput);
+	return rc;
+}
+
+LIBINPUT_EXPORT void
+libinput_dispatch_thread_stop(struct libinput *libinput)
+{
+	if (!libinput->thread.active)
+		return;
+
+	/* the thread needs the lock to notice it should stop */
+	assert(!libinput_thread_lock_held(libinput));
+
+	__atomic_store_n(&libinput->thread.stop, true, __ATOMIC_RELEASE);
+	eventfd_write(libinput->thread.wake_fd, 1);
+	pthread_join(libinput->thread.thread, NULL);
+
+	libinput->thread.active = false;
+	libinput->thread.wake_on_consume = false;
+
+	libinput_thread_recycle(libinput);
+	libinput_thread_unpublish(libinput);
+	libinput_thread_cleanup(libinput);
+}
+
+LIBINPUT_EXPORT void
+libinput_dispatch_thread_lock(struct libinput *libinput)
+{
+	pthread_mutex_lock(&libinput->thread.lock);
+	libinput->thread.lock_owner = pthread_self();
+	__atomic_store_n(&libinput->thread.caller_locked, true,
+			 __ATOMIC_RELEASE);
+}
+
+LIBINPUT_EXPORT void
+libinput_dispatch_thread_unlock(struct libinput *libinput)
+{
+	/* Events queued by the caller, e.g. for a device added with
+	 * libinput_path_add_device(), are published by the thread */
+	bool wake = libinput->thread.active && libinput->events_count > 0;
+
+	__atomic_store_n(&libinput->thread.caller_locked, false,
+			 __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&libinput->thread.lock);
+
+	if (wake)
+		eventfd_write(libinput->thread.wake_fd, 1);
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_queue_config_command(struct libinput *libinput,
+			      libinput_config_command_func_t apply,
+			      libinput_config_command_func_t discard,
+			      void *data)
+{
+	struct config_command *command;
+	uint64_t serial = 0;
+	int fd;
+
+	command = zalloc(sizeof *command);
+	if (!command)
+		return 0;
+
+	command->apply = apply;
+	command->discard = discard;
+	command->data = data;
+
+	pthread_mutex_lock(&libinput->config_commands.lock);
+
+	/* The fd is created on first use, epoll_ctl is safe to call
+	 * while another thread waits on the epoll fd */
+	if (!libinput->config_commands.source) {
+		fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (fd == -1)
+			goto out;
+
+		libinput->config_commands.source =
+			libinput_add_fd(libinput,
+					fd,
+					libinput_config_commands_dispatch,
+					libinput);
+		if (!libinput->config_commands.source) {
+			close(fd);
+			goto out;
+		}
+		libinput->config_commands.queue_fd = fd;
+	}
+
+	serial = ++libinput->config_commands.serial;
+	command->serial = serial;
+	list_insert(libinput->config_commands.queue.prev, &command->link);
+	command = NULL;
+
+	eventfd_write(libinput->config_commands.queue_fd, 1);
+
+out:
+	pthread_mutex_unlock(&libinput->config_commands.lock);
+	free(command);
+
+	return serial;
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_get_config_command_completed(struct libinput *libinput)
+{
+	return __atomic_load_n(&libinput->config_commands.completed,
+			       __ATOMIC_ACQUIRE);
+}
+
+LIBINPUT_EXPORT int
+libinput_get_config_command_fd(struct libinput *libinput)
+{
+	int fd;
+
+	pthread_mutex_lock(&libinput->config_commands.lock);
+	if (libinput->config_commands.completion_fd == -1)
+		libinput->config_commands.completion_fd =
+			eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+	fd = libinput->config_commands.completion_fd;
+	pthread_mutex_unlock(&libinput->config_commands.lock);
+
+	return fd < 0 ? -errno : fd;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_event_type_subscribed(struct libinput *libinput,
+				   enum libinput_event_type type,
+				   int subscribed)
+{
+	uint32_t bit = event_type_subscription_bit(type);
+
+	if (bit == 0)
+		return -EINVAL;
+
+	if (subscribed)
+		libinput->events_unsubscribed &= ~bit;
+	else
+		libinput->events_unsubscribed |= bit;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_event_type_subscribed(struct libinput *libinput,
+				   enum libinput_event_type type)
+{
+	return (libinput->events_unsubscribed &
+		event_type_subscription_bit(type)) == 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_set_dispatch_mode(struct libinput *libinput,
+			   enum libinput_dispatch_mode mode)
+{
+	switch (mode) {
+	case LIBINPUT_DISPATCH_MODE_DRAIN:
+	case LIBINPUT_DISPATCH_MODE_ROUND_ROBIN:
+	case LIBINPUT_DISPATCH_MODE_TIMESTAMP:
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	libinput->dispatch_mode = mode;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT enum libinput_dispatch_mode
+libinput_get_dispatch_mode(struct libinput *libinput)
+{
+	return libinput->dispatch_mode;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_dispatch_keyboard_priority(struct libinput *libinput,
+					int enable)
+{
+	libinput->dispatch_keyboard_priority = !!enable;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_dispatch_keyboard_priority(struct libinput *libinput)
+{
+	return libinput->dispatch_keyboard_priority;
+}
+
+LIBINPUT_EXPORT void
+libinput_set_latency_histogram_enabled(struct libinput *libinput,
+				       int enable)
+{
+	libinput->latency_histogram_enabled = !!enable;
+}
+
+LIBINPUT_EXPORT int
+libinput_get_latency_histogram_enabled(struct libinput *libinput)
+{
+	return libinput->latency_histogram_enabled;
+}
+
 LIBINPUT_EXPORT void
 libinput_set_user_data(struct libinput *libinput,
 		       void *user_data)
@@ -2572,6 +4530,72 @@ libinput_device_get_user_data(struct libinput_device *device)
 	return device->user_data;
 }
 
+LIBINPUT_EXPORT int
+libinput_device_set_event_type_subscribed(struct libinput_device *device,
+					  enum libinput_event_type type,
+					  int subscribed)
+{
+	uint32_t bit = event_type_subscription_bit(type);
+
+	if (bit == 0)
+		return -EINVAL;
+
+	if (subscribed)
+		device->events_unsubscribed &= ~bit;
+	else
+		device->events_unsubscribed |= bit;
+
+	return 0;
+}
+
+LIBINPUT_EXPORT int
+libinput_device_get_event_type_subscribed(struct libinput_device *device,
+					  enum libinput_event_type type)
+{
+	return (device->events_unsubscribed &
+		event_type_subscription_bit(type)) == 0;
+}
+
+LIBINPUT_EXPORT size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      uint64_t *buckets,
+				      size_t nbuckets)
+{
+	nbuckets = min(nbuckets, LATENCY_HISTOGRAM_BUCKETS);
+	if (nbuckets > 0)
+		memcpy(buckets,
+		       device->latency_histogram,
+		       nbuckets * sizeof *buckets);
+
+	return LATENCY_HISTOGRAM_BUCKETS;
+}
+
+LIBINPUT_EXPORT void
+libinput_device_reset_latency_histogram(struct libinput_device *device)
+{
+	memset(device->latency_histogram,
+	       0,
+	       sizeof(device->latency_histogram));
+}
+
+LIBINPUT_EXPORT uint64_t
+libinput_device_get_counter(struct libinput_device *device,
+			    enum libinput_device_counter counter)
+{
+	switch (counter) {
+	case LIBINPUT_DEVICE_COUNTER_EVDEV_EVENTS:
+		return counter_read(device->counters.evdev_events);
+	case LIBINPUT_DEVICE_COUNTER_SYN_REPORT:
+		return counter_read(device->counters.syn_report);
+	case LIBINPUT_DEVICE_COUNTER_SYN_DROPPED:
+		return counter_read(device->counters.syn_dropped);
+	case LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH:
+		return counter_read(device->counters.filter_dispatch);
+	}
+
+	return 0;
+}
+
 LIBINPUT_EXPORT struct libinput *
 libinput_device_get_context(struct libinput_device *device)
 {
@@ -3112,6 +5136,7 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	switch (profile) {
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT:
 	case LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE:
+	case LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM:
 		break;
 	default:
 		return LIBINPUT_CONFIG_STATUS_INVALID;
@@ -3124,6 +5149,37 @@ libinput_device_config_accel_set_profile(struct libinput_device *device,
 	return device->config.accel->set_profile(device, profile);
 }
 
+LIBINPUT_EXPORT enum libinput_config_status
+libinput_device_config_accel_set_custom_points(struct libinput_device *device,
+					       const double *velocities,
+					       const double *factors,
+					       size_t npoints)
+{
+	size_t i;
+
+	if (npoints == 0 || npoints > ACCEL_CUSTOM_MAX_POINTS)
+		return LIBINPUT_CONFIG_STATUS_INVALID;
+
+	for (i = 0; i < npoints; i++) {
+		if (!isfinite(velocities[i]) || velocities[i] < 0.0 ||
+		    !isfinite(factors[i]) || factors[i] < 0.0)
+			return LIBINPUT_CONFIG_STATUS_INVALID;
+
+		if (i > 0 && velocities[i] <= velocities[i - 1])
+			return LIBINPUT_CONFIG_STATUS_INVALID;
+	}
+
+	if (!libinput_device_config_accel_is_available(device) ||
+	    (libinput_device_config_accel_get_profiles(device) &
+	     LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM) == 0)
+		return LIBINPUT_CONFIG_STATUS_UNSUPPORTED;
+
+	return device->config.accel->set_custom_points(device,
+						       velocities,
+						       factors,
+						       npoints);
+}
+
 LIBINPUT_EXPORT int
 libinput_device_config_scroll_has_natural_scroll(struct libinput_device *device)
 {
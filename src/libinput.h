@@ -464,6 +464,20 @@ struct libinput_event_tablet_tool;
 void
 libinput_event_destroy(struct libinput_event *event);
 
+/**
+ * @ingroup event
+ *
+ * Destroy an array of events, as returned by libinput_get_events(). This
+ * is equivalent to calling libinput_event_destroy() on each event in turn.
+ * The array itself is not freed.
+ *
+ * @param events An array of events retrieved by libinput_get_events()
+ * @param nevents The number of events in the array
+ */
+void
+libinput_events_destroy(struct libinput_event **events,
+			size_t nevents);
+
 /**
  * @ingroup event
  *
@@ -2283,6 +2297,313 @@ libinput_get_fd(struct libinput *libinput);
 int
 libinput_dispatch(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Like libinput_dispatch(), but stop processing device events once the
+ * given time or number of evdev events is used up. Processing always
+ * stops at the end of a hardware frame (SYN_REPORT), so the budget may
+ * be exceeded by up to one frame. Internal timers and device hotplug are
+ * not subject to the budget.
+ *
+ * Events that were read from a device but not processed are kept and
+ * processed first on the next call to libinput_dispatch() or
+ * libinput_dispatch_budget(). The file descriptor returned by
+ * libinput_get_fd() does not signal input that is already buffered by
+ * libinput, the caller must call this function again while it returns 1.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param max_us The maximum time to spend processing device events in
+ * microseconds, or 0 for no time limit
+ * @param max_events The maximum number of evdev events to process, or 0
+ * for no limit
+ *
+ * @return 0 if all available input was processed, 1 if the budget was
+ * exhausted and input may remain, or a negative errno on failure
+ *
+ * @see libinput_dispatch
+ */
+int
+libinput_dispatch_budget(struct libinput *libinput,
+			 uint64_t max_us,
+			 size_t max_events);
+
+/**
+ * @ingroup base
+ *
+ * The order in which libinput_dispatch() processes input from devices
+ * with pending input.
+ */
+enum libinput_dispatch_mode {
+	/**
+	 * Process all available input of one device before moving on to
+	 * the next device. This is the default mode and has the lowest
+	 * overhead, but a device sending a lot of events delays the events
+	 * of all other devices.
+	 */
+	LIBINPUT_DISPATCH_MODE_DRAIN = 0,
+	/**
+	 * Process one hardware frame of each device in turn until all
+	 * input is processed. Events of different devices are interleaved
+	 * in the event queue.
+	 */
+	LIBINPUT_DISPATCH_MODE_ROUND_ROBIN,
+	/**
+	 * Always process the hardware frame with the earliest kernel
+	 * timestamp next. Events of different devices are queued in the
+	 * order of their timestamps.
+	 */
+	LIBINPUT_DISPATCH_MODE_TIMESTAMP,
+};
+
+/**
+ * @ingroup base
+ *
+ * Set the order in which libinput_dispatch() and
+ * libinput_dispatch_budget() process the input of different devices. The
+ * default mode is @ref LIBINPUT_DISPATCH_MODE_DRAIN.
+ *
+ * The ordering only applies to input that is available at the time of
+ * the dispatch, events read by a later dispatch are always queued after
+ * the events of this dispatch.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param mode The dispatch mode
+ * @return 0 on success or -EINVAL if the mode is invalid
+ *
+ * @see libinput_set_dispatch_keyboard_priority
+ */
+int
+libinput_set_dispatch_mode(struct libinput *libinput,
+			   enum libinput_dispatch_mode mode);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The current dispatch mode
+ *
+ * @see libinput_set_dispatch_mode
+ */
+enum libinput_dispatch_mode
+libinput_get_dispatch_mode(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Give devices with the @ref LIBINPUT_DEVICE_CAP_KEYBOARD capability
+ * priority over other devices. This includes keyboards and devices with
+ * buttons like power buttons. If enabled, the pending input of these
+ * devices is processed before the input of any other device, regardless
+ * of the timestamps.
+ *
+ * Priority only applies in @ref LIBINPUT_DISPATCH_MODE_ROUND_ROBIN and
+ * @ref LIBINPUT_DISPATCH_MODE_TIMESTAMP, it is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable priority, zero to disable it
+ *
+ * @see libinput_set_dispatch_mode
+ */
+void
+libinput_set_dispatch_keyboard_priority(struct libinput *libinput,
+					int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if keyboards have priority, zero otherwise
+ *
+ * @see libinput_set_dispatch_keyboard_priority
+ */
+int
+libinput_get_dispatch_keyboard_priority(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Start processing input on an internal thread. The thread reads and
+ * processes device input as soon as it is available, independent of how
+ * often the caller calls libinput_dispatch(). Processed events are handed
+ * to the caller through a lock-free queue.
+ *
+ * While the thread runs:
+ * - libinput_get_fd() returns a different file descriptor that becomes
+ *   readable when events are available. Callers must call
+ *   libinput_get_fd() again after starting the thread.
+ * - libinput_dispatch() and libinput_dispatch_budget() only reset that
+ *   file descriptor and always return 0.
+ * - libinput_get_fd(), libinput_dispatch(), libinput_dispatch_budget(),
+ *   libinput_get_event(), libinput_get_events(),
+ *   libinput_next_event_type(), the event accessors and
+ *   libinput_event_destroy() may be called without further
+ *   synchronization, but only from one thread at a time.
+ * - libinput_dispatch_thread_stop() and libinput_unref() must be called
+ *   without holding libinput_dispatch_thread_lock(), they wait for the
+ *   thread to finish.
+ * - Any other function must be called between
+ *   libinput_dispatch_thread_lock() and libinput_dispatch_thread_unlock().
+ * - The log handler and the open_restricted and close_restricted
+ *   callbacks may be called from the internal thread.
+ *
+ * A libinput context uses a single seat with the udev backend, the
+ * thread serves all devices of the context.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return 0 on success, -EALREADY if the thread is already running, or
+ * another negative errno if the thread could not be started
+ *
+ * @see libinput_dispatch_thread_stop
+ */
+int
+libinput_dispatch_thread_start(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Stop the internal thread started with libinput_dispatch_thread_start().
+ * Events the caller has not yet retrieved remain available through
+ * libinput_get_event(). After this call, libinput_get_fd() returns the
+ * original file descriptor again and the caller must call
+ * libinput_dispatch() as usual.
+ *
+ * libinput_unref() stops the thread automatically.
+ *
+ * This function must not be called while the caller holds
+ * libinput_dispatch_thread_lock(), the thread could not finish its
+ * current dispatch.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_dispatch_thread_start
+ */
+void
+libinput_dispatch_thread_stop(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Prevent the internal thread from processing input until
+ * libinput_dispatch_thread_unlock() is called. The thread holds this lock
+ * while it processes input, so this call may block for the duration of
+ * one dispatch. Locking is not recursive. libinput_event_destroy() may be
+ * called while the lock is held, libinput_dispatch_thread_stop() and
+ * libinput_unref() may not.
+ *
+ * If the thread is not running, this function has no visible effect.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_dispatch_thread_start
+ */
+void
+libinput_dispatch_thread_lock(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Release the lock taken with libinput_dispatch_thread_lock(). Events
+ * queued while the lock was held, e.g. for a device added with
+ * libinput_path_add_device(), become available to the caller shortly
+ * after.
+ *
+ * @param libinput A previously initialized libinput context
+ *
+ * @see libinput_dispatch_thread_lock
+ */
+void
+libinput_dispatch_thread_unlock(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * A configuration command queued with libinput_queue_config_command().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param data The caller-specific data passed to
+ * libinput_queue_config_command()
+ */
+typedef void (*libinput_config_command_func_t)(struct libinput *libinput,
+					       void *data);
+
+/**
+ * @ingroup base
+ *
+ * Queue a configuration command. This function may be called from any
+ * thread, the command is applied by the thread that calls
+ * libinput_dispatch() (or the internal thread, see
+ * libinput_dispatch_thread_start()) between two device frames, i.e. no
+ * device is in the middle of a hardware frame when the command runs.
+ * Commands are applied in the order they were queued, all commands queued
+ * before a dispatch are applied in the same dispatch.
+ *
+ * Inside the command, the caller may use any libinput function that is
+ * permitted during dispatch, e.g. the libinput_device_config_* setters.
+ * The caller must keep any device or other object used by the command
+ * referenced until the command has completed or was discarded.
+ *
+ * Commands still queued when the context is destroyed are not applied.
+ * Instead, libinput_unref() calls discard for each of them in the order
+ * they were queued, before any device is removed. The caller may release
+ * data and the references it holds in discard. A command that could not
+ * be queued calls neither function.
+ *
+ * Queueing a command makes the fd returned by libinput_get_fd() readable,
+ * the caller must call libinput_dispatch() for the command to be applied.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param apply The function to call
+ * @param discard The function to call instead of apply if the command is
+ * discarded, may be NULL
+ * @param data Caller-specific data passed to apply or discard
+ *
+ * @return A serial number greater than zero identifying the command, or
+ * zero if the command could not be queued
+ *
+ * @see libinput_get_config_command_completed
+ * @see libinput_get_config_command_fd
+ */
+uint64_t
+libinput_queue_config_command(struct libinput *libinput,
+			      libinput_config_command_func_t apply,
+			      libinput_config_command_func_t discard,
+			      void *data);
+
+/**
+ * @ingroup base
+ *
+ * Return the serial number of the last configuration command that was
+ * applied. Serial numbers increase monotonically, a command has completed
+ * if its serial is less than or equal to the returned value. This
+ * function may be called from any thread.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The serial of the last applied command, or zero if none
+ *
+ * @see libinput_queue_config_command
+ */
+uint64_t
+libinput_get_config_command_completed(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Return a file descriptor that becomes readable whenever one or more
+ * configuration commands were applied. The caller should read from the
+ * file descriptor to reset it and then call
+ * libinput_get_config_command_completed(). The file descriptor is owned by
+ * libinput and must not be closed by the caller. This function may be
+ * called from any thread.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The file descriptor, or a negative errno on failure
+ *
+ * @see libinput_queue_config_command
+ */
+int
+libinput_get_config_command_fd(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -2297,6 +2618,300 @@ libinput_dispatch(struct libinput *libinput);
 struct libinput_event *
 libinput_get_event(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Retrieve up to max_events events from libinput's internal event queue in
+ * one call. The events are returned in the same order as successive calls
+ * to libinput_get_event() would return them.
+ *
+ * After handling the retrieved events, the caller must destroy each of them
+ * using libinput_event_destroy() or all of them at once using
+ * libinput_events_destroy().
+ *
+ * @param libinput A previously initialized libinput context
+ * @param events An array of at least max_events elements to store the
+ * retrieved events in
+ * @param max_events The maximum number of events to retrieve
+ * @return The number of events stored in events, or 0 if no event is
+ * available.
+ *
+ * @see libinput_get_event
+ * @see libinput_events_destroy
+ */
+size_t
+libinput_get_events(struct libinput *libinput,
+		    struct libinput_event **events,
+		    size_t max_events);
+
+/**
+ * @ingroup base
+ *
+ * Behavior of the internal event queue when an event is queued while the
+ * queue is at capacity.
+ *
+ * @see libinput_event_queue_set_overflow_policy
+ */
+enum libinput_event_queue_overflow {
+	/**
+	 * Double the queue capacity. This is the default and never discards
+	 * events, but a client that stops retrieving events makes the queue
+	 * grow without bounds.
+	 */
+	LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW = 0,
+	/**
+	 * Discard the oldest queued pointer motion event (@ref
+	 * LIBINPUT_EVENT_POINTER_MOTION or @ref
+	 * LIBINPUT_EVENT_POINTER_MOTION_ABSOLUTE) to make room. If the
+	 * queue does not contain a pointer motion event, a new pointer
+	 * motion event is discarded instead. Any other event type is never
+	 * discarded, the queue grows if necessary. In particular, @ref
+	 * LIBINPUT_EVENT_TOUCH_MOTION and @ref
+	 * LIBINPUT_EVENT_TABLET_TOOL_AXIS events are never discarded, a
+	 * touch frame or a tablet tool sequence is always delivered
+	 * complete.
+	 */
+	LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION,
+	/**
+	 * Merge a new @ref LIBINPUT_EVENT_POINTER_MOTION event into the most
+	 * recent queued event if that event is a @ref
+	 * LIBINPUT_EVENT_POINTER_MOTION event of the same device. The
+	 * merged event has the sum of both deltas and the timestamp of the
+	 * new event. If the event cannot be merged, e.g. because another
+	 * device queued an event in between, this policy behaves like @ref
+	 * LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION. The queue thus stays in
+	 * the order of the event timestamps.
+	 */
+	LIBINPUT_EVENT_QUEUE_OVERFLOW_COALESCE,
+};
+
+/**
+ * @ingroup base
+ *
+ * Preallocate the internal event queue to hold at least capacity events.
+ * The queue does not need to allocate memory while fewer events than the
+ * capacity are queued. The capacity may be rounded up by libinput.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param capacity The minimum number of events the queue can hold
+ * @return 0 on success, -EINVAL if the capacity is invalid, -EBUSY if
+ * more events than the capacity are currently queued, or -ENOMEM if the
+ * queue could not be allocated
+ *
+ * @see libinput_event_queue_get_capacity
+ * @see libinput_event_queue_set_overflow_policy
+ */
+int
+libinput_event_queue_set_capacity(struct libinput *libinput,
+				  size_t capacity);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of events the internal event queue can hold before
+ * the overflow policy applies
+ *
+ * @see libinput_event_queue_set_capacity
+ */
+size_t
+libinput_event_queue_get_capacity(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Set the behavior of the internal event queue when an event is queued
+ * while the queue is at capacity. The default policy is @ref
+ * LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param policy The overflow policy
+ * @return 0 on success or -EINVAL if the policy is invalid
+ *
+ * @see libinput_event_queue_set_capacity
+ * @see libinput_event_queue_get_dropped_count
+ */
+int
+libinput_event_queue_set_overflow_policy(struct libinput *libinput,
+					 enum libinput_event_queue_overflow policy);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The current overflow policy of the internal event queue
+ *
+ * @see libinput_event_queue_set_overflow_policy
+ */
+enum libinput_event_queue_overflow
+libinput_event_queue_get_overflow_policy(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable coalescing of relative pointer motion events. If
+ * enabled, a new @ref LIBINPUT_EVENT_POINTER_MOTION event is merged into
+ * the most recently queued event if that event is a @ref
+ * LIBINPUT_EVENT_POINTER_MOTION event from the same device. The
+ * accelerated and unaccelerated deltas of the merged event are the sums
+ * of the respective deltas, the timestamp is that of the most recent
+ * event.
+ *
+ * This reduces the number of events a caller has to process when it
+ * cannot keep up with the device, at the cost of losing the intermediate
+ * timestamps. Coalescing is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable coalescing, zero to disable it
+ *
+ * @see libinput_event_queue_get_coalesced_count
+ */
+void
+libinput_event_queue_set_coalesce_motion(struct libinput *libinput,
+					 int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if relative pointer motion events are coalesced, zero
+ * otherwise
+ *
+ * @see libinput_event_queue_set_coalesce_motion
+ */
+int
+libinput_event_queue_get_coalesce_motion(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The highest number of events that were queued at any time
+ * during the lifetime of this context
+ */
+size_t
+libinput_event_queue_get_high_watermark(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of events discarded by the internal event queue
+ *
+ * @see libinput_event_queue_set_overflow_policy
+ */
+uint64_t
+libinput_event_queue_get_dropped_count(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return The number of events merged into an already queued event
+ *
+ * @see libinput_event_queue_set_overflow_policy
+ * @see libinput_event_queue_set_coalesce_motion
+ */
+uint64_t
+libinput_event_queue_get_coalesced_count(struct libinput *libinput);
+
+/**
+ * @ingroup base
+ *
+ * Context-wide performance counters, see libinput_get_counter().
+ */
+enum libinput_counter {
+	/**
+	 * The number of events of any type libinput queued or tried to
+	 * queue, including events that were later coalesced or dropped.
+	 */
+	LIBINPUT_COUNTER_EVENTS_POSTED = 1,
+	/**
+	 * The number of events merged into an already queued event, see
+	 * libinput_event_queue_get_coalesced_count().
+	 */
+	LIBINPUT_COUNTER_EVENTS_COALESCED,
+	/**
+	 * The number of events discarded by the event queue, see
+	 * libinput_event_queue_get_dropped_count().
+	 */
+	LIBINPUT_COUNTER_EVENTS_DROPPED,
+	/**
+	 * The number of times the event queue was full and had to be
+	 * reallocated to a larger size.
+	 */
+	LIBINPUT_COUNTER_EVENT_QUEUE_GROWN,
+	/**
+	 * The number of events recycled from a previously destroyed event.
+	 */
+	LIBINPUT_COUNTER_EVENT_POOL_HITS,
+	/**
+	 * The number of events that needed a new allocation.
+	 */
+	LIBINPUT_COUNTER_EVENT_POOL_MISSES,
+	/**
+	 * The number of times an internal timer was set.
+	 */
+	LIBINPUT_COUNTER_TIMER_ARMED,
+	/**
+	 * The number of internal timers that expired.
+	 */
+	LIBINPUT_COUNTER_TIMER_FIRED,
+	/**
+	 * The number of times libinput did not need to reprogram its
+	 * timerfd because the earliest timer did not change.
+	 */
+	LIBINPUT_COUNTER_TIMER_SETTIME_SKIPPED,
+};
+
+/**
+ * @ingroup base
+ *
+ * Return the current value of a performance counter. Counters start at
+ * zero when the context is created and are never reset, they only
+ * describe the work libinput did and have no effect on its behavior.
+ *
+ * Counters are maintained with relaxed atomic increments and may be read
+ * from a thread other than the one dispatching the context. The value is
+ * a snapshot and may be outdated by the time the caller looks at it.
+ *
+ * If libinput was built with counters disabled, all counters other than
+ * @ref LIBINPUT_COUNTER_EVENTS_COALESCED, @ref
+ * LIBINPUT_COUNTER_EVENTS_DROPPED, @ref LIBINPUT_COUNTER_EVENT_POOL_HITS,
+ * @ref LIBINPUT_COUNTER_EVENT_POOL_MISSES and @ref
+ * LIBINPUT_COUNTER_TIMER_SETTIME_SKIPPED are always zero.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param counter The counter to read
+ * @return The value of the counter or 0 if the counter is invalid
+ *
+ * @see libinput_get_event_type_counter
+ * @see libinput_device_get_counter
+ */
+uint64_t
+libinput_get_counter(struct libinput *libinput,
+		     enum libinput_counter counter);
+
+/**
+ * @ingroup base
+ *
+ * Return the number of events of the given type libinput queued or tried
+ * to queue, see @ref LIBINPUT_COUNTER_EVENTS_POSTED. Events the caller is
+ * not subscribed to are not created and thus not counted.
+ *
+ * If libinput was built with counters disabled, this function always
+ * returns zero.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type
+ * @return The number of events of this type or 0 if the type is invalid
+ *
+ * @see libinput_get_counter
+ */
+uint64_t
+libinput_get_event_type_counter(struct libinput *libinput,
+				enum libinput_event_type type);
+
 /**
  * @ingroup base
  *
@@ -2311,6 +2926,84 @@ libinput_get_event(struct libinput *libinput);
 enum libinput_event_type
 libinput_next_event_type(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Subscribe to or unsubscribe from events of the given type for all
+ * devices in this context. libinput does not create events of a type the
+ * caller is not subscribed to, reducing the overhead for event types the
+ * caller is not interested in. Device state (e.g. the seat-wide key
+ * count) is updated regardless of the subscription.
+ *
+ * Events already in the queue are not affected by this call. By default,
+ * the caller is subscribed to all event types. An event is created only
+ * if the caller is subscribed to the type for both the context and the
+ * device, see libinput_device_set_event_type_subscribed().
+ *
+ * The caller cannot unsubscribe from @ref LIBINPUT_EVENT_DEVICE_ADDED
+ * and @ref LIBINPUT_EVENT_DEVICE_REMOVED.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to subscribe to or unsubscribe from
+ * @param subscribed Non-zero to subscribe, zero to unsubscribe
+ * @return 0 on success or -EINVAL if the event type is invalid or cannot
+ * be unsubscribed from
+ *
+ * @see libinput_get_event_type_subscribed
+ */
+int
+libinput_set_event_type_subscribed(struct libinput *libinput,
+				   enum libinput_event_type type,
+				   int subscribed);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @param type The event type to check
+ * @return Non-zero if the caller is subscribed to events of this type in
+ * this context, zero otherwise
+ *
+ * @see libinput_set_event_type_subscribed
+ */
+int
+libinput_get_event_type_subscribed(struct libinput *libinput,
+				   enum libinput_event_type type);
+
+/**
+ * @ingroup base
+ *
+ * Enable or disable recording of event latencies for all devices in this
+ * context. If enabled, the time between an event's timestamp and the time
+ * the caller retrieves it with libinput_get_event() or
+ * libinput_get_events() is added to the latency histogram of the event's
+ * device. For most events the timestamp is the kernel timestamp of the
+ * underlying evdev event, so the latency includes the time spent in the
+ * kernel buffer, in libinput and in the event queue.
+ *
+ * Events without a timestamp, e.g. @ref LIBINPUT_EVENT_DEVICE_ADDED, are
+ * not recorded. Recording is disabled by default.
+ *
+ * @param libinput A previously initialized libinput context
+ * @param enable Non-zero to enable recording, zero to disable it
+ *
+ * @see libinput_device_get_latency_histogram
+ */
+void
+libinput_set_latency_histogram_enabled(struct libinput *libinput,
+				       int enable);
+
+/**
+ * @ingroup base
+ *
+ * @param libinput A previously initialized libinput context
+ * @return Non-zero if event latencies are recorded, zero otherwise
+ *
+ * @see libinput_set_latency_histogram_enabled
+ */
+int
+libinput_get_latency_histogram_enabled(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -2364,6 +3057,22 @@ libinput_resume(struct libinput *libinput);
 void
 libinput_suspend(struct libinput *libinput);
 
+/**
+ * @ingroup base
+ *
+ * Load the tablet database now rather than when the first tablet is
+ * added. The database is loaded once per context and kept until the
+ * context is destroyed, loading it takes a noticeable amount of time.
+ * A caller that expects tablets may call this function immediately after
+ * creating the context to keep that delay off the input path.
+ *
+ * @param libinput A previously initialized libinput context
+ * @return 0 on success, -ENOENT if the database could not be loaded or
+ * -ENOTSUP if libinput was built without tablet database support
+ */
+int
+libinput_preload_tablet_database(struct libinput *libinput);
+
 /**
  * @ingroup base
  *
@@ -2646,6 +3355,127 @@ libinput_device_set_user_data(struct libinput_device *device, void *user_data);
 void *
 libinput_device_get_user_data(struct libinput_device *device);
 
+/**
+ * @ingroup device
+ *
+ * Subscribe to or unsubscribe from events of the given type for this
+ * device. This is the per-device equivalent of
+ * libinput_set_event_type_subscribed(), an event is only created if the
+ * caller is subscribed to its type for both the context and the device.
+ *
+ * Events already in the queue are not affected by this call. By default,
+ * the caller is subscribed to all event types.
+ *
+ * @param device A previously obtained device
+ * @param type The event type to subscribe to or unsubscribe from
+ * @param subscribed Non-zero to subscribe, zero to unsubscribe
+ * @return 0 on success or -EINVAL if the event type is invalid or cannot
+ * be unsubscribed from
+ *
+ * @see libinput_device_get_event_type_subscribed
+ */
+int
+libinput_device_set_event_type_subscribed(struct libinput_device *device,
+					  enum libinput_event_type type,
+					  int subscribed);
+
+/**
+ * @ingroup device
+ *
+ * @param device A previously obtained device
+ * @param type The event type to check
+ * @return Non-zero if the caller is subscribed to events of this type for
+ * this device, zero otherwise. The context-wide subscription is not taken
+ * into account.
+ *
+ * @see libinput_device_set_event_type_subscribed
+ */
+int
+libinput_device_get_event_type_subscribed(struct libinput_device *device,
+					  enum libinput_event_type type);
+
+/**
+ * @ingroup device
+ *
+ * Get the latency histogram of this device, see
+ * libinput_set_latency_histogram_enabled(). The histogram is
+ * logarithmic, bucket 0 counts the events with a latency of less than
+ * 2us, bucket n counts the events with a latency of at least 2^n us and
+ * less than 2^(n+1) us. The last bucket also counts all events with a
+ * higher latency.
+ *
+ * Up to nbuckets buckets are copied into buckets, starting with bucket 0.
+ * To get the number of buckets, call this function with nbuckets 0.
+ *
+ * @param device A previously obtained device
+ * @param buckets The array to copy the bucket counts into, may be NULL if
+ * nbuckets is 0
+ * @param nbuckets The number of elements in buckets
+ * @return The number of buckets in the histogram, regardless of nbuckets
+ *
+ * @see libinput_device_reset_latency_histogram
+ */
+size_t
+libinput_device_get_latency_histogram(struct libinput_device *device,
+				      uint64_t *buckets,
+				      size_t nbuckets);
+
+/**
+ * @ingroup device
+ *
+ * Reset all buckets of the latency histogram of this device to zero.
+ *
+ * @param device A previously obtained device
+ *
+ * @see libinput_device_get_latency_histogram
+ */
+void
+libinput_device_reset_latency_histogram(struct libinput_device *device);
+
+/**
+ * @ingroup device
+ *
+ * Per-device performance counters, see libinput_device_get_counter().
+ */
+enum libinput_device_counter {
+	/**
+	 * The number of evdev events read from the device node.
+	 */
+	LIBINPUT_DEVICE_COUNTER_EVDEV_EVENTS = 1,
+	/**
+	 * The number of evdev frames, i.e. SYN_REPORT events, processed.
+	 */
+	LIBINPUT_DEVICE_COUNTER_SYN_REPORT,
+	/**
+	 * The number of times the kernel buffer overflowed and events were
+	 * lost. Unlike the log message, this counter is not rate-limited.
+	 */
+	LIBINPUT_DEVICE_COUNTER_SYN_DROPPED,
+	/**
+	 * The number of motion deltas passed through the pointer
+	 * acceleration filter.
+	 */
+	LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH,
+};
+
+/**
+ * @ingroup device
+ *
+ * Return the current value of a per-device performance counter. This is
+ * the per-device equivalent of libinput_get_counter(), the same
+ * constraints apply. If libinput was built with counters disabled, all
+ * per-device counters are always zero.
+ *
+ * @param device A previously obtained device
+ * @param counter The counter to read
+ * @return The value of the counter or 0 if the counter is invalid
+ *
+ * @see libinput_get_counter
+ */
+uint64_t
+libinput_device_get_counter(struct libinput_device *device,
+			    enum libinput_device_counter counter);
+
 /**
  * @ingroup device
  *
@@ -3578,6 +4408,14 @@ enum libinput_config_accel_profile {
 	 * on the input speed. This is the default profile for most devices.
 	 */
 	LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE = (1 << 1),
+
+	/**
+	 * A custom acceleration profile. Pointer acceleration depends on
+	 * the input speed as described by a caller-supplied curve.
+	 *
+	 * @see libinput_device_config_accel_set_custom_points
+	 */
+	LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM = (1 << 2),
 };
 
 /**
@@ -3632,6 +4470,38 @@ libinput_device_config_accel_get_profile(struct libinput_device *device);
 enum libinput_config_accel_profile
 libinput_device_config_accel_get_default_profile(struct libinput_device *device);
 
+/**
+ * @ingroup config
+ *
+ * Set the curve used by the @ref LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM
+ * acceleration profile. The curve consists of npoints pairs of a pointer
+ * velocity and the acceleration factor at that velocity. Between two
+ * points, the factor is linearly interpolated. Below the first and above
+ * the last point, the factor of that point applies.
+ *
+ * Velocities are in units/ms, normalized to 1000dpi, and must be in
+ * strictly ascending order. Factors must not be negative. At most 64
+ * points can be set.
+ *
+ * The curve applies whenever the custom profile is the current profile.
+ * Until a curve is set, the custom profile uses a constant factor of 1.
+ * The speed setting has no effect on the custom profile.
+ *
+ * @param device The device to configure
+ * @param velocities npoints velocities in units/ms, in ascending order
+ * @param factors npoints acceleration factors
+ * @param npoints The number of points on the curve
+ *
+ * @return A config status code
+ *
+ * @see libinput_device_config_accel_set_profile
+ */
+enum libinput_config_status
+libinput_device_config_accel_set_custom_points(struct libinput_device *device,
+					       const double *velocities,
+					       const double *factors,
+					       size_t npoints);
+
 /**
  * @ingroup config
  *
@@ -26,6 +26,8 @@
 #include <assert.h>
 #include <errno.h>
 #include <inttypes.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/timerfd.h>
 #include <unistd.h>
@@ -43,39 +45,150 @@ libinput_timer_init(struct libinput_timer *timer, struct libinput *libinput,
 	timer->timer_func_data = timer_func_data;
 }
 
+static inline void
+timer_heap_assign(struct libinput *libinput,
+		  size_t idx,
+		  struct libinput_timer *timer)
+{
+	libinput->timer.heap[idx] = timer;
+	timer->heap_index = idx;
+}
+
+static void
+timer_heap_sift_up(struct libinput *libinput, size_t idx)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[idx];
+	size_t parent;
+
+	while (idx > 0) {
+		parent = (idx - 1) / 2;
+		if (heap[parent]->expire <= timer->expire)
+			break;
+
+		timer_heap_assign(libinput, idx, heap[parent]);
+		idx = parent;
+	}
+
+	timer_heap_assign(libinput, idx, timer);
+}
+
+static void
+timer_heap_sift_down(struct libinput *libinput, size_t idx)
+{
+	struct libinput_timer **heap = libinput->timer.heap;
+	struct libinput_timer *timer = heap[idx];
+	size_t len = libinput->timer.heap_len;
+	size_t child;
+
+	while ((child = 2 * idx + 1) < len) {
+		if (child + 1 < len &&
+		    heap[child + 1]->expire < heap[child]->expire)
+			child++;
+
+		if (timer->expire <= heap[child]->expire)
+			break;
+
+		timer_heap_assign(libinput, idx, heap[child]);
+		idx = child;
+	}
+
+	timer_heap_assign(libinput, idx, timer);
+}
+
+static bool
+timer_heap_insert(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = libinput->timer.heap_len;
+
+	if (idx == libinput->timer.heap_size) {
+		struct libinput_timer **heap;
+		size_t size = max(libinput->timer.heap_size * 2, 16);
+
+		heap = realloc(libinput->timer.heap, size * sizeof(*heap));
+		if (!heap)
+			return false;
+
+		libinput->timer.heap = heap;
+		libinput->timer.heap_size = size;
+	}
+
+	libinput->timer.heap_len++;
+	timer_heap_assign(libinput, idx, timer);
+	timer_heap_sift_up(libinput, idx);
+
+	return true;
+}
+
+static void
+timer_heap_remove(struct libinput *libinput, struct libinput_timer *timer)
+{
+	size_t idx = timer->heap_index;
+	size_t last = --libinput->timer.heap_len;
+	struct libinput_timer *moved;
+
+	assert(libinput->timer.heap[idx] == timer);
+
+	if (idx == last)
+		return;
+
+	/* Move the last timer into the hole and restore the heap property
+	 * in whichever direction it is violated */
+	moved = libinput->timer.heap[last];
+	timer_heap_assign(libinput, idx, moved);
+	timer_heap_sift_up(libinput, idx);
+	timer_heap_sift_down(libinput, moved->heap_index);
+}
+
 static void
 libinput_timer_arm_timer_fd(struct libinput *libinput)
 {
 	int r;
-	struct libinput_timer *timer;
 	struct itimerspec its = { { 0, 0 }, { 0, 0 } };
-	uint64_t earliest_expire = UINT64_MAX;
+	uint64_t earliest_expire = 0;
+
+	/* The handler arms the timerfd once all expired timers were
+	 * handled */
+	if (libinput->timer.in_handler)
+		return;
+
+	if (libinput->timer.heap_len > 0)
+		earliest_expire = libinput->timer.heap[0]->expire;
 
-	list_for_each(timer, &libinput->timer.list, link) {
-		if (timer->expire < earliest_expire)
-			earliest_expire = timer->expire;
+	if (earliest_expire == libinput->timer.armed_expire) {
+		libinput->timer.settime_skipped++;
+		return;
 	}
 
-	if (earliest_expire != UINT64_MAX) {
+	if (earliest_expire != 0) {
 		its.it_value.tv_sec = earliest_expire / ms2us(1000);
 		its.it_value.tv_nsec = (earliest_expire % ms2us(1000)) * 1000;
 	}
 
 	r = timerfd_settime(libinput->timer.fd, TFD_TIMER_ABSTIME, &its, NULL);
-	if (r)
+	if (r) {
 		log_error(libinput, "timerfd_settime error: %s\n", strerror(errno));
+		/* force a retry on the next change */
+		libinput->timer.armed_expire = UINT64_MAX;
+		return;
+	}
+
+	libinput->timer.armed_expire = earliest_expire;
 }
 
 void
 libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 {
+	struct libinput *libinput = timer->libinput;
+	uint64_t old_expire = timer->expire;
+
 #ifndef NDEBUG
-	uint64_t now = libinput_now(timer->libinput);
+	uint64_t now = libinput_now(libinput);
 	if (expire < now)
-		log_bug_libinput(timer->libinput,
+		log_bug_libinput(libinput,
 				 "timer offset negative\n");
 	else if ((expire - now) > ms2us(5000))
-		log_bug_libinput(timer->libinput,
+		log_bug_libinput(libinput,
 				 "timer offset more than 5s, now %"
 				 PRIu64 " expire %" PRIu64 "\n",
 				 now, expire);
@@ -83,11 +196,23 @@ libinput_timer_set(struct libinput_timer *timer, uint64_t expire)
 
 	assert(expire);
 
-	if (!timer->expire)
-		list_insert(&timer->libinput->timer.list, &timer->link);
-
+	counter_inc(libinput->timer.armed);
 	timer->expire = expire;
-	libinput_timer_arm_timer_fd(timer->libinput);
+	timer->handler_serial = libinput->timer.handler_serial;
+
+	if (!old_expire) {
+		if (!timer_heap_insert(libinput, timer)) {
+			log_error(libinput, "Failed to allocate timer\n");
+			timer->expire = 0;
+			return;
+		}
+	} else if (expire < old_expire) {
+		timer_heap_sift_up(libinput, timer->heap_index);
+	} else {
+		timer_heap_sift_down(libinput, timer->heap_index);
+	}
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 void
@@ -97,38 +222,112 @@ libinput_timer_cancel(struct libinput_timer *timer)
 		return;
 
 	timer->expire = 0;
-	list_remove(&timer->link);
+	timer_heap_remove(timer->libinput, timer);
 	libinput_timer_arm_timer_fd(timer->libinput);
 }
 
+/* Collect the timers expired at now, the subtree below a timer that
+ * has not expired yet cannot contain an expired timer */
+static size_t
+timer_heap_collect_expired(struct libinput *libinput,
+			   size_t idx,
+			   uint64_t now,
+			   size_t nexpired)
+{
+	struct libinput_timer *timer;
+
+	if (idx >= libinput->timer.heap_len)
+		return nexpired;
+
+	timer = libinput->timer.heap[idx];
+	if (timer->expire > now)
+		return nexpired;
+
+	libinput->timer.expired[nexpired++] = timer;
+	nexpired = timer_heap_collect_expired(libinput, 2 * idx + 1,
+					      now, nexpired);
+	return timer_heap_collect_expired(libinput, 2 * idx + 2,
+					  now, nexpired);
+}
+
+static int
+timer_compare_expire(const void *a, const void *b)
+{
+	const struct libinput_timer *ta = *(struct libinput_timer * const *)a;
+	const struct libinput_timer *tb = *(struct libinput_timer * const *)b;
+
+	return (ta->expire > tb->expire) - (ta->expire < tb->expire);
+}
+
 static void
 libinput_timer_handler(void *data)
 {
 	struct libinput *libinput = data;
-	struct libinput_timer *timer, *tmp;
-	uint64_t now;
-	uint64_t discard;
-	int r;
+	struct libinput_timer *timer;
+	uint64_t now, serial;
+	size_t i, nexpired;
+	ssize_t r;
 
-	r = read(libinput->timer.fd, &discard, sizeof(discard));
-	if (r == -1 && errno != EAGAIN)
+	r = libinput_source_read(libinput, libinput->timer.source);
+	if (r < 0 && r != -EAGAIN)
 		log_bug_libinput(libinput,
 				 "Error %d reading from timerfd (%s)",
-				 errno,
-				 strerror(errno));
+				 (int)-r,
+				 strerror(-r));
+
+	/* A timerfd is disarmed once it expired */
+	libinput->timer.armed_expire = 0;
 
 	now = libinput_now(libinput);
-	if (now == 0)
+	if (now == 0) {
+		libinput_timer_arm_timer_fd(libinput);
 		return;
+	}
+
+	if (libinput->timer.expired_size < libinput->timer.heap_len) {
+		struct libinput_timer **expired;
 
-	list_for_each_safe(timer, tmp, &libinput->timer.list, link) {
-		if (timer->expire <= now) {
-			/* Clear the timer before calling timer_func,
-			   as timer_func may re-arm it */
-			libinput_timer_cancel(timer);
-			timer->timer_func(now, timer->timer_func_data);
+		expired = realloc(libinput->timer.expired,
+				  libinput->timer.heap_size *
+				  sizeof(*expired));
+		if (!expired) {
+			log_error(libinput, "Failed to allocate timers\n");
+			libinput_timer_arm_timer_fd(libinput);
+			return;
 		}
+		libinput->timer.expired = expired;
+		libinput->timer.expired_size = libinput->timer.heap_size;
 	}
+
+	/* The set of expired timers is fixed on entry. A timer_func may
+	 * re-arm its timer (or others) with an expiry that has already
+	 * passed; those are handled on the next timerfd wakeup rather than
+	 * looping here indefinitely. A timer cancelled by an earlier
+	 * timer_func does not fire. */
+	serial = ++libinput->timer.handler_serial;
+	nexpired = timer_heap_collect_expired(libinput, 0, now, 0);
+	qsort(libinput->timer.expired,
+	      nexpired,
+	      sizeof(*libinput->timer.expired),
+	      timer_compare_expire);
+
+	libinput->timer.in_handler = true;
+	for (i = 0; i < nexpired; i++) {
+		timer = libinput->timer.expired[i];
+		if (timer->expire == 0 ||
+		    timer->expire > now ||
+		    timer->handler_serial == serial)
+			continue;
+
+		/* Clear the timer before calling timer_func,
+		   as timer_func may re-arm it */
+		libinput_timer_cancel(timer);
+		counter_inc(libinput->timer.fired);
+		timer->timer_func(now, timer->timer_func_data);
+	}
+	libinput->timer.in_handler = false;
+
+	libinput_timer_arm_timer_fd(libinput);
 }
 
 int
@@ -139,12 +338,13 @@ libinput_timer_subsys_init(struct libinput *libinput)
 	if (libinput->timer.fd < 0)
 		return -1;
 
-	list_init(&libinput->timer.list);
-
-	libinput->timer.source = libinput_add_fd(libinput,
-						 libinput->timer.fd,
-						 libinput_timer_handler,
-						 libinput);
+	libinput->timer.source =
+		libinput_add_fd_read(libinput,
+				     libinput->timer.fd,
+				     &libinput->timer.expirations,
+				     sizeof(libinput->timer.expirations),
+				     libinput_timer_handler,
+				     libinput);
 	if (!libinput->timer.source) {
 		close(libinput->timer.fd);
 		return -1;
@@ -157,8 +357,14 @@ void
 libinput_timer_subsys_destroy(struct libinput *libinput)
 {
 	/* All timer users should have destroyed their timers now */
-	assert(list_empty(&libinput->timer.list));
+	assert(libinput->timer.heap_len == 0);
+
+	log_debug(libinput,
+		  "timer: %" PRIu64 " timerfd_settime calls skipped\n",
+		  libinput->timer.settime_skipped);
 
 	libinput_remove_source(libinput, libinput->timer.source);
 	close(libinput->timer.fd);
+	free(libinput->timer.heap);
+	free(libinput->timer.expired);
 }
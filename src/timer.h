@@ -32,8 +32,9 @@ struct libinput;
 
 struct libinput_timer {
 	struct libinput *libinput;
-	struct list link;
+	size_t heap_index; /* only valid while armed */
 	uint64_t expire; /* in absolute us CLOCK_MONOTONIC */
+	uint64_t handler_serial; /* handler call it was last set in */
 	void (*timer_func)(uint64_t now, void *timer_func_data);
 	void *timer_func_data;
 };
@@ -0,0 +1,293 @@
+/*
+ * Copyright © 2026 The libinput authors
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <config.h>
+
+#include <check.h>
+#include <inttypes.h>
+#include <math.h>
+
+#include "filter.h"
+#include "litest.h"
+
+typedef struct motion_filter *(*filter_create_func)(int dpi);
+
+struct filter_deviation {
+	unsigned int nevents;
+	unsigned int noutliers; /* more than 1% off */
+	double mean;		/* relative */
+};
+
+static double
+next_random(uint32_t *state)
+{
+	*state = *state * 1103515245 + 12345;
+	return ((*state >> 16) & 0x7fff) / 32767.0;
+}
+
+/* Feed the same motion into both filters: bursts of movement that speed
+ * up, slow down and curve, separated by pauses. */
+static void
+compare_filters(struct motion_filter *reference,
+		struct motion_filter *filter,
+		uint64_t interval,
+		struct filter_deviation *deviation)
+{
+	struct normalized_coords delta, expected, accelerated;
+	uint32_t state = 1;
+	uint64_t time = ms2us(1000);
+	double angle = 0.0, speed = 0.0;
+	double sum = 0.0;
+	double error;
+	int i;
+
+	deviation->nevents = 0;
+	deviation->noutliers = 0;
+
+	for (i = 0; i < 10000; i++) {
+		if (i % 500 == 0) {
+			filter_restart(reference, NULL, time);
+			filter_restart(filter, NULL, time);
+			time += ms2us(500);
+		}
+
+		time += interval;
+
+		angle += (next_random(&state) - 0.5) * 0.3;
+		speed += (next_random(&state) - 0.5) * 0.5;
+		speed = min(fabs(speed), 40.0); /* units per 8ms */
+
+		delta.x = round(speed * cos(angle) * interval / ms2us(2));
+		delta.y = round(speed * sin(angle) * interval / ms2us(2));
+		if (normalized_is_zero(delta))
+			continue;
+
+		expected = filter_dispatch(reference, &delta, NULL, time);
+		accelerated = filter_dispatch(filter, &delta, NULL, time);
+
+		error = normalized_length((struct normalized_coords) {
+						  accelerated.x - expected.x,
+						  accelerated.y - expected.y
+					  }) / normalized_length(expected);
+		sum += error;
+		if (error > 0.01)
+			deviation->noutliers++;
+		deviation->nevents++;
+	}
+
+	deviation->mean = sum / deviation->nevents;
+}
+
+START_TEST(filter_fixed_point_deviation)
+{
+	struct {
+		filter_create_func reference, fixed;
+		int dpi;
+	} filters[] = {
+		{ create_pointer_accelerator_filter_linear,
+		  create_pointer_accelerator_filter_linear_fixed, 1000 },
+		{ create_pointer_accelerator_filter_touchpad,
+		  create_pointer_accelerator_filter_touchpad_fixed, 1000 },
+		/* a dpi factor that is exact in binary, otherwise the
+		 * floating point sums of scaled deltas can land on either
+		 * side of the direction thresholds */
+		{ create_pointer_accelerator_filter_trackpoint,
+		  create_pointer_accelerator_filter_trackpoint_fixed, 500 },
+	};
+	double speeds[] = { -1.0, 0.0, 1.0 };
+	uint64_t intervals[] = { ms2us(8), ms2us(1), 250 };
+	struct motion_filter *reference, *fixed;
+	struct filter_deviation deviation;
+	unsigned int f, s, i;
+
+	for (f = 0; f < ARRAY_LENGTH(filters); f++) {
+	for (s = 0; s < ARRAY_LENGTH(speeds); s++) {
+	for (i = 0; i < ARRAY_LENGTH(intervals); i++) {
+		reference = filters[f].reference(filters[f].dpi);
+		fixed = filters[f].fixed(filters[f].dpi);
+		ck_assert_notnull(reference);
+		ck_assert_notnull(fixed);
+
+		filter_set_speed(reference, speeds[s]);
+		filter_set_speed(fixed, speeds[s]);
+
+		compare_filters(reference, fixed, intervals[i], &deviation);
+
+		/* Rounding moves the velocity and direction thresholds, so
+		 * the odd event takes a different path. Anything systematic
+		 * shows up in the mean. */
+		ck_assert_int_gt(deviation.nevents, 1000);
+		ck_assert_msg(deviation.mean < 0.0005,
+			      "filter %u speed %.1f interval %" PRIu64 ": "
+			      "mean deviation %f",
+			      f, speeds[s], intervals[i], deviation.mean);
+		ck_assert_msg(deviation.noutliers * 100 < deviation.nevents,
+			      "filter %u speed %.1f interval %" PRIu64 ": "
+			      "%u of %u events off by more than 1%%",
+			      f, speeds[s], intervals[i],
+			      deviation.noutliers, deviation.nevents);
+
+		filter_destroy(reference);
+		filter_destroy(fixed);
+	}
+	}
+	}
+}
+END_TEST
+
+static struct motion_filter *
+create_custom_filter(int dpi)
+{
+	static const double velocities[] = { 0.0, 0.4, 1.0, 3.0 };
+	static const double factors[] = { 0.5, 1.0, 1.7, 3.5 };
+
+	return create_pointer_accelerator_filter_custom(dpi,
+							velocities,
+							factors,
+							ARRAY_LENGTH(velocities));
+}
+
+static double
+lut_error(struct motion_filter *filter,
+	  accel_profile_func_t profile,
+	  double velocity)
+{
+	double factor;
+
+	ck_assert(pointer_accelerator_lookup_factor(filter,
+						    velocity,
+						    &factor));
+
+	return fabs(factor - profile(filter, NULL, velocity, 0));
+}
+
+/* Wider than two table intervals of any filter */
+#define LUT_BREAKPOINT_RANGE 0.00001 /* units/us */
+
+START_TEST(filter_lookup_table_breakpoints)
+{
+	filter_create_func filters[] = {
+		create_pointer_accelerator_filter_linear,
+		create_pointer_accelerator_filter_linear_low_dpi,
+		create_pointer_accelerator_filter_touchpad,
+		create_pointer_accelerator_filter_lenovo_x230,
+		create_pointer_accelerator_filter_trackpoint,
+		create_pointer_accelerator_filter_linear_fixed,
+		create_custom_filter,
+	};
+	double speeds[] = { -1.0, 0.0, 1.0 };
+	const double step = 0.0000001; /* units/us */
+	struct motion_filter *filter;
+	accel_profile_func_t profile;
+	double v, u, d2, error, bound, sum;
+	unsigned int f, s, nbreakpoints, nsamples;
+
+	for (f = 0; f < ARRAY_LENGTH(filters); f++) {
+	for (s = 0; s < ARRAY_LENGTH(speeds); s++) {
+		filter = filters[f](1000);
+		ck_assert_notnull(filter);
+		filter_set_speed(filter, speeds[s]);
+
+		profile = pointer_accelerator_get_profile(filter);
+		ck_assert_notnull(profile);
+
+		nbreakpoints = 0;
+		nsamples = 0;
+		sum = 0.0;
+
+		for (v = step; v < 0.006; v += step) {
+			sum += lut_error(filter, profile, v);
+			nsamples++;
+
+			/* a kink or a jump in the profile */
+			d2 = profile(filter, NULL, v + step, 0) -
+			     2 * profile(filter, NULL, v, 0) +
+			     profile(filter, NULL, v - step, 0);
+			if (fabs(d2) < 1e-7)
+				continue;
+
+			nbreakpoints++;
+
+			/* Next to the breakpoint, the table matches the
+			 * profile. Within the table interval that contains
+			 * it, the interpolation cannot be further off than
+			 * the profile changes across the breakpoint. */
+			bound = fabs(profile(filter, NULL,
+					     v + LUT_BREAKPOINT_RANGE, 0) -
+				     profile(filter, NULL,
+					     v - LUT_BREAKPOINT_RANGE, 0));
+			for (u = v - 2 * LUT_BREAKPOINT_RANGE;
+			     u < v + 2 * LUT_BREAKPOINT_RANGE;
+			     u += step) {
+				if (u <= 0.0)
+					continue;
+
+				error = lut_error(filter, profile, u);
+				if (fabs(u - v) > LUT_BREAKPOINT_RANGE)
+					ck_assert_msg(error < 1e-6,
+						      "filter %u speed %.1f: "
+						      "error %f at %f next to "
+						      "breakpoint %f",
+						      f, speeds[s], error, u, v);
+				else
+					ck_assert_msg(error <= bound + 1e-6,
+						      "filter %u speed %.1f: "
+						      "error %f at breakpoint %f",
+						      f, speeds[s], error, v);
+			}
+
+			/* skip past this breakpoint */
+			v += LUT_BREAKPOINT_RANGE;
+		}
+
+		ck_assert_int_gt(nbreakpoints, 0);
+		ck_assert_msg(sum / nsamples < 0.0001,
+			      "filter %u speed %.1f: mean error %f",
+			      f, speeds[s], sum / nsamples);
+
+		filter_destroy(filter);
+	}
+	}
+}
+END_TEST
+
+START_TEST(filter_lookup_table_no_profile)
+{
+	struct motion_filter *filter;
+	double factor;
+
+	filter = create_pointer_accelerator_filter_flat(1000);
+	ck_assert_notnull(filter);
+	ck_assert(pointer_accelerator_get_profile(filter) == NULL);
+	ck_assert(!pointer_accelerator_lookup_factor(filter, 0.001, &factor));
+	filter_destroy(filter);
+}
+END_TEST
+
+void
+litest_setup_tests(void)
+{
+	litest_add_no_device("filter:fixed-point", filter_fixed_point_deviation);
+	litest_add_no_device("filter:lookup-table", filter_lookup_table_breakpoints);
+	litest_add_no_device("filter:lookup-table", filter_lookup_table_no_profile);
+}
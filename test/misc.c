@@ -28,6 +28,7 @@
 #include <fcntl.h>
 #include <libinput.h>
 #include <libinput-util.h>
+#include <poll.h>
 #include <unistd.h>
 
 #include "litest.h"
@@ -436,6 +437,1023 @@ START_TEST(event_conversion_tablet)
 }
 END_TEST
 
+START_TEST(event_queue_get_events)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *events[3];
+	size_t count, total = 0;
+	size_t i;
+	int n;
+
+	litest_drain_events(li);
+
+	for (n = 0; n < 10; n++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_get_events(li, events, 0), 0);
+
+	while ((count = libinput_get_events(li, events, ARRAY_LENGTH(events)))) {
+		ck_assert_int_le(count, ARRAY_LENGTH(events));
+		for (i = 0; i < count; i++) {
+			ck_assert_notnull(events[i]);
+			ck_assert(libinput_event_get_device(events[i]) ==
+				  dev->libinput_device);
+		}
+		total += count;
+
+		/* the last batch holds the button events in order */
+		if (libinput_next_event_type(li) == LIBINPUT_EVENT_NONE) {
+			litest_is_button_event(events[count - 1],
+					       BTN_LEFT,
+					       LIBINPUT_BUTTON_STATE_RELEASED);
+		}
+
+		libinput_events_destroy(events, count);
+	}
+
+	ck_assert_int_eq(total, 12);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_queue_capacity)
+{
+	struct libinput *li;
+
+	li = litest_create_context();
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 0), -EINVAL);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 5), 0);
+	ck_assert_int_ge(libinput_event_queue_get_capacity(li), 5);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 64), 0);
+	ck_assert_int_ge(libinput_event_queue_get_capacity(li), 64);
+
+	ck_assert_int_eq(libinput_event_queue_get_overflow_policy(li),
+			 LIBINPUT_EVENT_QUEUE_OVERFLOW_GROW);
+	ck_assert_int_eq(libinput_event_queue_set_overflow_policy(li, 10),
+			 -EINVAL);
+	ck_assert_int_eq(libinput_event_queue_set_overflow_policy(li,
+				LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION),
+			 0);
+	ck_assert_int_eq(libinput_event_queue_get_overflow_policy(li),
+			 LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION);
+
+	libinput_unref(li);
+}
+END_TEST
+
+START_TEST(event_queue_overflow_drop_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	size_t capacity;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 4), 0);
+	capacity = libinput_event_queue_get_capacity(li);
+	libinput_event_queue_set_overflow_policy(li,
+				LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION);
+
+	for (i = 0; i < (int)capacity + 6; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	/* motion events made room for the button events, the queue did not
+	 * grow */
+	ck_assert_int_eq(libinput_event_queue_get_capacity(li), capacity);
+	ck_assert_int_eq(libinput_event_queue_get_high_watermark(li),
+			 capacity);
+	ck_assert_int_eq(libinput_event_queue_get_dropped_count(li), 8);
+
+	for (i = 0; i < (int)capacity - 2; i++) {
+		event = libinput_get_event(li);
+		litest_is_motion_event(event);
+		libinput_event_destroy(event);
+	}
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_queue_overflow_drop_motion_touch)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	size_t capacity;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 4), 0);
+	capacity = libinput_event_queue_get_capacity(li);
+	libinput_event_queue_set_overflow_policy(li,
+				LIBINPUT_EVENT_QUEUE_OVERFLOW_DROP_MOTION);
+
+	litest_touch_down(dev, 0, 10, 10);
+	for (i = 0; i < (int)capacity * 2; i++)
+		litest_touch_move(dev, 0, 10 + i, 10);
+	litest_touch_up(dev, 0);
+	libinput_dispatch(li);
+
+	/* touch frames are never broken up, the queue grows instead */
+	ck_assert_int_eq(libinput_event_queue_get_dropped_count(li), 0);
+	ck_assert_int_gt(libinput_event_queue_get_capacity(li), capacity);
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_DOWN);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+
+	for (i = 0; i < (int)capacity * 2; i++) {
+		event = libinput_get_event(li);
+		litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_MOTION);
+		libinput_event_destroy(event);
+		event = libinput_get_event(li);
+		litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+		libinput_event_destroy(event);
+	}
+
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_UP);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_touch_event(event, LIBINPUT_EVENT_TOUCH_FRAME);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(event_queue_overflow_coalesce)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	size_t capacity;
+	double dx = 0.0;
+	int i, nevents = 0;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 4), 0);
+	capacity = libinput_event_queue_get_capacity(li);
+	libinput_event_queue_set_overflow_policy(li,
+				LIBINPUT_EVENT_QUEUE_OVERFLOW_COALESCE);
+
+	for (i = 0; i < (int)capacity + 6; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_event_queue_get_capacity(li), capacity);
+	ck_assert_int_eq(libinput_event_queue_get_coalesced_count(li), 6);
+	ck_assert_int_eq(libinput_event_queue_get_dropped_count(li), 0);
+
+	while ((event = libinput_get_event(li))) {
+		ptrev = litest_is_motion_event(event);
+		dx += libinput_event_pointer_get_dx_unaccelerated(ptrev);
+		nevents++;
+		libinput_event_destroy(event);
+	}
+
+	ck_assert_int_eq(nevents, capacity);
+	ck_assert_double_eq(dx, capacity + 6);
+}
+END_TEST
+
+START_TEST(event_queue_coalesce_motion)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct libinput_event_pointer *ptrev;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_queue_get_coalesce_motion(li), 0);
+	libinput_event_queue_set_coalesce_motion(li, 1);
+	ck_assert_int_ne(libinput_event_queue_get_coalesce_motion(li), 0);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_Y, -1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_event_queue_get_coalesced_count(li), 6);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dx_unaccelerated(ptrev),
+			    5.0);
+	ck_assert_double_gt(libinput_event_pointer_get_dx(ptrev), 0.0);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_PRESSED);
+	libinput_event_destroy(event);
+	event = libinput_get_event(li);
+	litest_is_button_event(event,
+			       BTN_LEFT,
+			       LIBINPUT_BUTTON_STATE_RELEASED);
+	libinput_event_destroy(event);
+
+	event = libinput_get_event(li);
+	ptrev = litest_is_motion_event(event);
+	ck_assert_double_eq(libinput_event_pointer_get_dy_unaccelerated(ptrev),
+			    -3.0);
+	ck_assert_double_lt(libinput_event_pointer_get_dy(ptrev), 0.0);
+	libinput_event_destroy(event);
+
+	litest_assert_empty_queue(li);
+
+	libinput_event_queue_set_coalesce_motion(li, 0);
+}
+END_TEST
+
+START_TEST(event_type_subscription)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_set_event_type_subscribed(li,
+					LIBINPUT_EVENT_DEVICE_ADDED,
+					0),
+			 -EINVAL);
+	ck_assert_int_eq(libinput_device_set_event_type_subscribed(device,
+					LIBINPUT_EVENT_DEVICE_REMOVED,
+					0),
+			 -EINVAL);
+	ck_assert_int_eq(libinput_set_event_type_subscribed(li,
+					LIBINPUT_EVENT_NONE,
+					0),
+			 -EINVAL);
+
+	/* context-wide */
+	ck_assert(libinput_get_event_type_subscribed(li,
+					LIBINPUT_EVENT_POINTER_MOTION));
+	ck_assert_int_eq(libinput_set_event_type_subscribed(li,
+					LIBINPUT_EVENT_POINTER_MOTION,
+					0),
+			 0);
+	ck_assert(!libinput_get_event_type_subscribed(li,
+					LIBINPUT_EVENT_POINTER_MOTION));
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_BUTTON);
+
+	libinput_set_event_type_subscribed(li,
+					   LIBINPUT_EVENT_POINTER_MOTION,
+					   1);
+
+	/* per-device */
+	ck_assert_int_eq(libinput_device_set_event_type_subscribed(device,
+					LIBINPUT_EVENT_POINTER_BUTTON,
+					0),
+			 0);
+	ck_assert(!libinput_device_get_event_type_subscribed(device,
+					LIBINPUT_EVENT_POINTER_BUTTON));
+	ck_assert(libinput_get_event_type_subscribed(li,
+					LIBINPUT_EVENT_POINTER_BUTTON));
+
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_assert_empty_queue(li);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_MOTION);
+
+	libinput_device_set_event_type_subscribed(device,
+						  LIBINPUT_EVENT_POINTER_BUTTON,
+						  1);
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_assert_only_typed_events(li, LIBINPUT_EVENT_POINTER_BUTTON);
+}
+END_TEST
+
+static uint64_t
+latency_histogram_sum(struct libinput_device *device)
+{
+	uint64_t buckets[64];
+	uint64_t sum = 0;
+	size_t i, nbuckets;
+
+	nbuckets = libinput_device_get_latency_histogram(device,
+							 buckets,
+							 ARRAY_LENGTH(buckets));
+	ck_assert_int_le(nbuckets, ARRAY_LENGTH(buckets));
+
+	for (i = 0; i < nbuckets; i++)
+		sum += buckets[i];
+
+	return sum;
+}
+
+START_TEST(event_latency_histogram)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct libinput_event *event;
+	struct libinput_event *events[4];
+	uint64_t buckets[64];
+	size_t nbuckets, count;
+	int i, nevents = 0;
+
+	litest_drain_events(li);
+
+	nbuckets = libinput_device_get_latency_histogram(device, NULL, 0);
+	ck_assert_int_gt(nbuckets, 0);
+	ck_assert_int_le(nbuckets, ARRAY_LENGTH(buckets));
+
+	/* disabled by default */
+	ck_assert(!libinput_get_latency_histogram_enabled(li));
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_drain_events(li);
+	ck_assert_int_eq(latency_histogram_sum(device), 0);
+
+	libinput_set_latency_histogram_enabled(li, 1);
+	ck_assert(libinput_get_latency_histogram_enabled(li));
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	ck_assert_notnull(event);
+	libinput_event_destroy(event);
+	nevents++;
+
+	while ((count = libinput_get_events(li, events, ARRAY_LENGTH(events)))) {
+		libinput_events_destroy(events, count);
+		nevents += count;
+	}
+	ck_assert_int_eq(nevents, 7);
+	ck_assert_int_eq(latency_histogram_sum(device), nevents);
+
+	/* nothing in the test suite takes half an hour */
+	libinput_device_get_latency_histogram(device, buckets, nbuckets);
+	ck_assert_int_eq(buckets[nbuckets - 1], 0);
+
+	libinput_device_reset_latency_histogram(device);
+	ck_assert_int_eq(latency_histogram_sum(device), 0);
+
+	/* A coalesced event's latency is measured from its most recent
+	 * motion, not from the first one merged into it */
+	libinput_event_queue_set_coalesce_motion(li, 1);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	msleep(100);
+	litest_event(dev, EV_REL, REL_X, 1);
+	litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	libinput_dispatch(li);
+
+	event = libinput_get_event(li);
+	litest_is_motion_event(event);
+	libinput_event_destroy(event);
+	litest_assert_empty_queue(li);
+	libinput_event_queue_set_coalesce_motion(li, 0);
+
+	/* bucket 16 starts at 65ms */
+	libinput_device_get_latency_histogram(device, buckets, nbuckets);
+	ck_assert_int_eq(latency_histogram_sum(device), 1);
+	for (i = 16; i < (int)nbuckets; i++)
+		ck_assert_int_eq(buckets[i], 0);
+
+	libinput_device_reset_latency_histogram(device);
+	libinput_set_latency_histogram_enabled(li, 0);
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_drain_events(li);
+	ck_assert_int_eq(latency_histogram_sum(device), 0);
+}
+END_TEST
+
+START_TEST(performance_counters)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	uint64_t motion, button, posted, frames, evdev, filter;
+	int i;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_counter(li, 0), 0);
+	ck_assert_int_eq(libinput_get_event_type_counter(li,
+						LIBINPUT_EVENT_NONE),
+			 0);
+	ck_assert_int_eq(libinput_device_get_counter(device, 0), 0);
+
+	motion = libinput_get_event_type_counter(li,
+					LIBINPUT_EVENT_POINTER_MOTION);
+	button = libinput_get_event_type_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON);
+	posted = libinput_get_counter(li, LIBINPUT_COUNTER_EVENTS_POSTED);
+	evdev = libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_EVDEV_EVENTS);
+	frames = libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_SYN_REPORT);
+	filter = libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	litest_drain_events(li);
+
+#if HAVE_COUNTERS
+	ck_assert_int_eq(libinput_get_event_type_counter(li,
+					LIBINPUT_EVENT_POINTER_MOTION),
+			 motion + 5);
+	ck_assert_int_eq(libinput_get_event_type_counter(li,
+					LIBINPUT_EVENT_POINTER_BUTTON),
+			 button + 2);
+	ck_assert_int_eq(libinput_get_counter(li,
+					LIBINPUT_COUNTER_EVENTS_POSTED),
+			 posted + 7);
+	ck_assert_int_ge(libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_EVDEV_EVENTS),
+			 evdev + 14);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_SYN_REPORT),
+			 frames + 7);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH),
+			 filter + 5);
+	ck_assert_int_eq(libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_SYN_DROPPED),
+			 0);
+#else
+	ck_assert_int_eq(motion + button + posted + evdev + frames + filter,
+			 0);
+	ck_assert_int_eq(libinput_get_counter(li,
+					LIBINPUT_COUNTER_EVENTS_POSTED),
+			 0);
+#endif
+}
+END_TEST
+
+static size_t
+drain_and_count_events(struct libinput *li)
+{
+	struct libinput_event *events[16];
+	size_t count, total = 0;
+
+	while ((count = libinput_get_events(li, events, ARRAY_LENGTH(events)))) {
+		libinput_events_destroy(events, count);
+		total += count;
+	}
+
+	return total;
+}
+
+START_TEST(dispatch_budget_events)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int i;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* two evdev events per frame */
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 4), 1);
+	ck_assert_int_eq(drain_and_count_events(li), 2);
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 4), 1);
+	ck_assert_int_eq(drain_and_count_events(li), 2);
+
+	/* no limit */
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 0), 0);
+	ck_assert_int_eq(drain_and_count_events(li), 6);
+
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 4), 0);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(dispatch_budget_frame_boundary)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	int i;
+
+	litest_drain_events(li);
+
+	for (i = 0; i < 3; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_REL, REL_Y, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	/* a frame is never split */
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 1), 1);
+	ck_assert_int_eq(drain_and_count_events(li), 1);
+
+	/* buffered events are processed by a normal dispatch too */
+	libinput_dispatch(li);
+	ck_assert_int_eq(drain_and_count_events(li), 2);
+	ck_assert_int_eq(libinput_dispatch_budget(li, 0, 1), 0);
+}
+END_TEST
+
+START_TEST(dispatch_budget_two_devices)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct pollfd fds;
+	int i, rc, count, total = 0;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	for (i = 0; i < 10; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		litest_keyboard_key(keyboard, KEY_A, i % 2 == 0);
+	}
+
+	/* The budget only covers one frame, so the second device often
+	 * has input waiting (with io_uring: already read) when the budget
+	 * runs out. That input must not wait for new input on the device. */
+	while (total < 20) {
+		rc = libinput_dispatch_budget(li, 0, 2);
+		ck_assert_int_ge(rc, 0);
+		count = drain_and_count_events(li);
+		total += count;
+
+		if (rc == 0 && count == 0)
+			ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+	}
+	ck_assert_int_eq(total, 20);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+/* Five motion events on the mouse and five key events on the keyboard,
+ * alternating between the devices */
+static void
+dispatch_mode_interleaved_input(struct litest_device *mouse,
+				struct litest_device *keyboard)
+{
+	int i;
+
+	for (i = 0; i < 5; i++) {
+		litest_event(mouse, EV_REL, REL_X, 1);
+		litest_event(mouse, EV_SYN, SYN_REPORT, 0);
+		litest_keyboard_key(keyboard, KEY_A, i % 2 == 0);
+	}
+}
+
+static uint64_t
+dispatch_mode_event_time(struct libinput_event *event)
+{
+	switch (libinput_event_get_type(event)) {
+	case LIBINPUT_EVENT_POINTER_MOTION:
+		return libinput_event_pointer_get_time_usec(
+				libinput_event_get_pointer_event(event));
+	case LIBINPUT_EVENT_KEYBOARD_KEY:
+		return libinput_event_keyboard_get_time_usec(
+				libinput_event_get_keyboard_event(event));
+	default:
+		litest_abort_msg("Unexpected event type %d\n",
+				 libinput_event_get_type(event));
+	}
+
+	return 0;
+}
+
+START_TEST(event_queue_overflow_coalesce_order)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	uint64_t time, last = 0;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_event_queue_set_capacity(li, 4), 0);
+	libinput_event_queue_set_overflow_policy(li,
+				LIBINPUT_EVENT_QUEUE_OVERFLOW_COALESCE);
+
+	/* the mouse's last motion is never the tail of the queue */
+	dispatch_mode_interleaved_input(dev, keyboard);
+	libinput_dispatch(li);
+
+	ck_assert_int_eq(libinput_event_queue_get_coalesced_count(li), 0);
+
+	while ((event = libinput_get_event(li))) {
+		time = dispatch_mode_event_time(event);
+		ck_assert_int_ge(time, last);
+		last = time;
+		libinput_event_destroy(event);
+	}
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_mode_round_robin)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	enum libinput_event_type last = LIBINPUT_EVENT_NONE;
+	int nevents = 0;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_get_dispatch_mode(li),
+			 LIBINPUT_DISPATCH_MODE_DRAIN);
+	ck_assert_int_eq(libinput_set_dispatch_mode(li,
+					LIBINPUT_DISPATCH_MODE_TIMESTAMP + 1),
+			 -EINVAL);
+	ck_assert_int_eq(libinput_set_dispatch_mode(li,
+					LIBINPUT_DISPATCH_MODE_ROUND_ROBIN),
+			 0);
+	ck_assert_int_eq(libinput_get_dispatch_mode(li),
+			 LIBINPUT_DISPATCH_MODE_ROUND_ROBIN);
+
+	dispatch_mode_interleaved_input(dev, keyboard);
+	libinput_dispatch(li);
+
+	/* one frame per device per turn */
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_ne(libinput_event_get_type(event), last);
+		last = libinput_event_get_type(event);
+		libinput_event_destroy(event);
+		nevents++;
+	}
+	ck_assert_int_eq(nevents, 10);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_mode_timestamp)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	uint64_t time, last = 0;
+	int nevents = 0;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	libinput_set_dispatch_mode(li, LIBINPUT_DISPATCH_MODE_TIMESTAMP);
+
+	dispatch_mode_interleaved_input(dev, keyboard);
+	libinput_dispatch(li);
+
+	while ((event = libinput_get_event(li))) {
+		time = dispatch_mode_event_time(event);
+		ck_assert_int_ge(time, last);
+		last = time;
+		libinput_event_destroy(event);
+		nevents++;
+	}
+	ck_assert_int_eq(nevents, 10);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_mode_keyboard_priority)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct litest_device *keyboard;
+	struct libinput_event *event;
+	int nevents = 0;
+
+	keyboard = litest_add_device(li, LITEST_KEYBOARD);
+	litest_drain_events(li);
+
+	libinput_set_dispatch_mode(li, LIBINPUT_DISPATCH_MODE_TIMESTAMP);
+	ck_assert(!libinput_get_dispatch_keyboard_priority(li));
+	libinput_set_dispatch_keyboard_priority(li, 1);
+	ck_assert(libinput_get_dispatch_keyboard_priority(li));
+
+	dispatch_mode_interleaved_input(dev, keyboard);
+	libinput_dispatch(li);
+
+	/* all keys first, even though the first motion event is older */
+	while ((event = libinput_get_event(li))) {
+		ck_assert_int_eq(libinput_event_get_type(event),
+				 nevents < 5 ?
+				 LIBINPUT_EVENT_KEYBOARD_KEY :
+				 LIBINPUT_EVENT_POINTER_MOTION);
+		libinput_event_destroy(event);
+		nevents++;
+	}
+	ck_assert_int_eq(nevents, 10);
+
+	litest_delete_device(keyboard);
+}
+END_TEST
+
+START_TEST(dispatch_thread)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	struct pollfd fds;
+	int fd, i, nevents = 0;
+
+	litest_drain_events(li);
+
+	fd = libinput_get_fd(li);
+	ck_assert_int_eq(libinput_dispatch_thread_start(li), 0);
+	ck_assert_int_eq(libinput_dispatch_thread_start(li), -EALREADY);
+	ck_assert_int_ne(libinput_get_fd(li), fd);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+
+	while (nevents < 5) {
+		ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+		libinput_dispatch(li);
+
+		while ((event = libinput_get_event(li))) {
+			litest_is_motion_event(event);
+			libinput_event_destroy(event);
+			nevents++;
+		}
+	}
+	ck_assert_int_eq(nevents, 5);
+
+	libinput_dispatch_thread_lock(li);
+	ck_assert_int_eq(libinput_device_config_accel_set_speed(
+						dev->libinput_device,
+						0.5),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+	libinput_dispatch_thread_unlock(li);
+
+	/* events the caller did not retrieve survive the thread */
+	litest_button_click(dev, BTN_LEFT, true);
+	litest_button_click(dev, BTN_LEFT, false);
+	ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+
+	libinput_dispatch_thread_stop(li);
+	ck_assert_int_eq(libinput_get_fd(li), fd);
+
+	libinput_dispatch(li);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_PRESSED);
+	litest_assert_button_event(li, BTN_LEFT, LIBINPUT_BUTTON_STATE_RELEASED);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+START_TEST(dispatch_thread_destroy_locked)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	/* more than the thread's ring of returned events holds */
+	struct libinput_event *events[600];
+	struct pollfd fds;
+	int i, nsent = 0, nevents = 0;
+
+	litest_drain_events(li);
+
+	ck_assert_int_eq(libinput_dispatch_thread_start(li), 0);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+
+	/* in small batches so the kernel's buffer doesn't overflow */
+	while (nsent < (int)ARRAY_LENGTH(events)) {
+		for (i = 0; i < 10; i++) {
+			litest_event(dev, EV_REL, REL_X, 1);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		}
+		nsent += 10;
+
+		while (nevents < nsent) {
+			ck_assert_int_eq(poll(&fds, 1, 1000), 1);
+			libinput_dispatch(li);
+
+			while (nevents < nsent &&
+			       (events[nevents] = libinput_get_event(li))) {
+				litest_is_motion_event(events[nevents]);
+				nevents++;
+			}
+		}
+	}
+
+	/* once the ring is full, the events are destroyed directly. This
+	 * must not take the lock again */
+	libinput_dispatch_thread_lock(li);
+	for (i = 0; i < nevents; i++)
+		libinput_event_destroy(events[i]);
+	libinput_dispatch_thread_unlock(li);
+
+	libinput_dispatch_thread_stop(li);
+
+	libinput_dispatch(li);
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static void
+config_command_set_speed(struct libinput *li, void *data)
+{
+	struct litest_device *dev = data;
+
+	ck_assert_int_eq(libinput_device_config_accel_set_speed(
+						dev->libinput_device,
+						0.5),
+			 LIBINPUT_CONFIG_STATUS_SUCCESS);
+}
+
+START_TEST(config_command_queue)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct pollfd fds;
+	uint64_t first, second;
+	int fd;
+
+	litest_drain_events(li);
+
+	fd = libinput_get_config_command_fd(li);
+	ck_assert_int_ge(fd, 0);
+	ck_assert_int_eq(libinput_get_config_command_fd(li), fd);
+	ck_assert_int_eq(libinput_get_config_command_completed(li), 0);
+
+	first = libinput_queue_config_command(li,
+					      config_command_set_speed,
+					      NULL,
+					      dev);
+	second = libinput_queue_config_command(li,
+					       config_command_set_speed,
+					       NULL,
+					       dev);
+	ck_assert_int_gt(first, 0);
+	ck_assert_int_gt(second, first);
+
+	/* nothing is applied until the next dispatch */
+	ck_assert_int_eq(libinput_get_config_command_completed(li), 0);
+	ck_assert(libinput_device_config_accel_get_speed(
+						dev->libinput_device) != 0.5);
+
+	fds.fd = libinput_get_fd(li);
+	fds.events = POLLIN;
+	fds.revents = 0;
+	ck_assert_int_eq(poll(&fds, 1, 0), 1);
+
+	libinput_dispatch(li);
+	ck_assert_int_eq(libinput_get_config_command_completed(li), second);
+	ck_assert(libinput_device_config_accel_get_speed(
+						dev->libinput_device) == 0.5);
+
+	fds.fd = fd;
+	ck_assert_int_eq(poll(&fds, 1, 0), 1);
+
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
+static void
+config_command_not_applied(struct libinput *li, void *data)
+{
+	litest_abort_msg("Discarded command was applied\n");
+}
+
+static void
+config_command_discard(struct libinput *li, void *data)
+{
+	int *discarded = data;
+
+	(*discarded)++;
+}
+
+START_TEST(config_command_discarded)
+{
+	struct libinput *li;
+	int discarded[2] = { 0, 0 };
+
+	/* the second command has no discard function */
+	li = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_int_gt(libinput_queue_config_command(li,
+						       config_command_not_applied,
+						       config_command_discard,
+						       &discarded[0]),
+			 0);
+	ck_assert_int_gt(libinput_queue_config_command(li,
+						       config_command_not_applied,
+						       NULL,
+						       &discarded[1]),
+			 0);
+	libinput_unref(li);
+
+	ck_assert_int_eq(discarded[0], 1);
+	ck_assert_int_eq(discarded[1], 0);
+}
+END_TEST
+
+START_TEST(preload_tablet_database)
+{
+	struct libinput *li;
+	int expected;
+
+#if HAVE_LIBWACOM
+	expected = 0;
+#else
+	expected = -ENOTSUP;
+#endif
+
+	li = libinput_path_create_context(&simple_interface, NULL);
+	ck_assert_int_eq(libinput_preload_tablet_database(li), expected);
+	/* loaded once, kept until the context is destroyed */
+	ck_assert_int_eq(libinput_preload_tablet_database(li), expected);
+	libinput_unref(li);
+}
+END_TEST
+
 START_TEST(bitfield_helpers)
 {
 	/* This value has a bit set on all of the word boundaries we want to
@@ -895,6 +1913,27 @@ litest_setup_tests(void)
 	litest_add_for_device("events:conversion", event_conversion_touch, LITEST_WACOM_TOUCH);
 	litest_add_for_device("events:conversion", event_conversion_gesture, LITEST_BCM5974);
 	litest_add_for_device("events:conversion", event_conversion_tablet, LITEST_WACOM_CINTIQ);
+	litest_add_for_device("events:queue", event_queue_get_events, LITEST_MOUSE);
+	litest_add_no_device("events:queue", event_queue_capacity);
+	litest_add_for_device("events:queue", event_queue_overflow_drop_motion, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_overflow_drop_motion_touch, LITEST_GENERIC_SINGLETOUCH);
+	litest_add_for_device("events:queue", event_queue_overflow_coalesce, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_overflow_coalesce_order, LITEST_MOUSE);
+	litest_add_for_device("events:queue", event_queue_coalesce_motion, LITEST_MOUSE);
+	litest_add_for_device("events:subscription", event_type_subscription, LITEST_MOUSE);
+	litest_add_for_device("events:latency", event_latency_histogram, LITEST_MOUSE);
+	litest_add_for_device("events:counters", performance_counters, LITEST_MOUSE);
+	litest_add_for_device("dispatch:budget", dispatch_budget_events, LITEST_MOUSE);
+	litest_add_for_device("dispatch:budget", dispatch_budget_frame_boundary, LITEST_MOUSE);
+	litest_add_for_device("dispatch:budget", dispatch_budget_two_devices, LITEST_MOUSE);
+	litest_add_for_device("dispatch:mode", dispatch_mode_round_robin, LITEST_MOUSE);
+	litest_add_for_device("dispatch:mode", dispatch_mode_timestamp, LITEST_MOUSE);
+	litest_add_for_device("dispatch:mode", dispatch_mode_keyboard_priority, LITEST_MOUSE);
+	litest_add_for_device("dispatch:thread", dispatch_thread, LITEST_MOUSE);
+	litest_add_for_device("dispatch:thread", dispatch_thread_destroy_locked, LITEST_MOUSE);
+	litest_add_for_device("config:commands", config_command_queue, LITEST_MOUSE);
+	litest_add_no_device("config:commands", config_command_discarded);
+	litest_add_no_device("context:tablet-database", preload_tablet_database);
 	litest_add_no_device("bitfield_helpers", bitfield_helpers);
 
 	litest_add_no_device("context:refcount", context_ref_counting);
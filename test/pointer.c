@@ -1072,6 +1072,7 @@ START_TEST(pointer_accel_profile_defaults)
 	profiles = libinput_device_config_accel_get_profiles(device);
 	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE);
 	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
+	ck_assert(profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
 
 	status = libinput_device_config_accel_set_profile(device,
 							  LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT);
@@ -1117,6 +1118,12 @@ START_TEST(pointer_accel_profile_defaults_noprofile)
 	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_UNSUPPORTED);
 	profile = libinput_device_config_accel_get_profile(device);
 	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_NONE);
+
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_UNSUPPORTED);
+	profile = libinput_device_config_accel_get_profile(device);
+	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_NONE);
 }
 END_TEST
 
@@ -1163,6 +1170,128 @@ START_TEST(pointer_accel_profile_flat_motion_relative)
 }
 END_TEST
 
+static void
+assert_custom_accel_factor(struct libinput_event *event, double factor)
+{
+	struct libinput_event_pointer *ptrev;
+	double dx, dx_unaccel;
+
+	ptrev = litest_is_motion_event(event);
+	dx = libinput_event_pointer_get_dx(ptrev);
+	dx_unaccel = libinput_event_pointer_get_dx_unaccelerated(ptrev);
+	ck_assert_double_ne(dx_unaccel, 0.0);
+	ck_assert_double_eq(dx/dx_unaccel, factor);
+}
+
+START_TEST(pointer_accel_profile_custom)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput_device *device = dev->libinput_device;
+	enum libinput_config_status status;
+	enum libinput_config_accel_profile profile;
+	double velocities[] = { 0.0, 1.0, 3.0 };
+	double factors[] = { 0.5, 1.0, 2.0 };
+	double unsorted[] = { 0.0, 3.0, 1.0 };
+	double negative[] = { -1.0, 1.0, 2.0 };
+	double speed_velocities[] = { 0.0, 0.5, 5.0 };
+	double speed_factors[] = { 0.5, 0.5, 2.0 };
+	struct libinput *li = dev->libinput;
+	struct libinput_event *event;
+	int i;
+
+	status = libinput_device_config_accel_set_custom_points(device,
+								velocities,
+								factors,
+								0);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_accel_set_custom_points(device,
+								unsorted,
+								factors,
+								3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+	status = libinput_device_config_accel_set_custom_points(device,
+								velocities,
+								negative,
+								3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_INVALID);
+
+	/* the curve can be set before and after selecting the profile */
+	status = libinput_device_config_accel_set_custom_points(device,
+								velocities,
+								factors,
+								3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+
+	status = libinput_device_config_accel_set_profile(device,
+							  LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	profile = libinput_device_config_accel_get_profile(device);
+	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+
+	status = libinput_device_config_accel_set_custom_points(device,
+								velocities,
+								factors,
+								2);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	profile = libinput_device_config_accel_get_profile(device);
+	ck_assert_int_eq(profile, LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM);
+
+	litest_drain_events(dev->libinput);
+
+	test_relative_event(dev, 1, 0);
+	test_relative_event(dev, 1, 1);
+	test_relative_event(dev, 1, -1);
+	test_relative_event(dev, 0, 1);
+
+	test_relative_event(dev, -1, 0);
+	test_relative_event(dev, -1, 1);
+	test_relative_event(dev, -1, -1);
+	test_relative_event(dev, 0, -1);
+
+	/* A curve that is flat at 0.5 for slow motion and at 2.0 for fast
+	 * motion. Slow motion is 1 unit every 20ms, i.e. 0.05 units/ms,
+	 * fast motion is 20 units per event without delay. */
+	status = libinput_device_config_accel_set_custom_points(device,
+								speed_velocities,
+								speed_factors,
+								3);
+	ck_assert_int_eq(status, LIBINPUT_CONFIG_STATUS_SUCCESS);
+	litest_drain_events(li);
+
+	for (i = 0; i < 5; i++) {
+		litest_event(dev, EV_REL, REL_X, 1);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+		libinput_dispatch(li);
+
+		event = libinput_get_event(li);
+		assert_custom_accel_factor(event, 0.5);
+		libinput_event_destroy(event);
+		litest_assert_empty_queue(li);
+
+		msleep(20);
+	}
+
+	/* Send all fast events before dispatching so their timestamps are
+	 * as close together as possible. The first few events still see
+	 * the slow motion in the trackers. */
+	for (i = 0; i < 20; i++) {
+		litest_event(dev, EV_REL, REL_X, 20);
+		litest_event(dev, EV_SYN, SYN_REPORT, 0);
+	}
+	libinput_dispatch(li);
+
+	for (i = 0; i < 20; i++) {
+		event = libinput_get_event(li);
+		if (i < 10)
+			litest_is_motion_event(event);
+		else
+			assert_custom_accel_factor(event, 2.0);
+		libinput_event_destroy(event);
+	}
+	litest_assert_empty_queue(li);
+}
+END_TEST
+
 START_TEST(middlebutton)
 {
 	struct litest_device *device = litest_current_device();
@@ -1617,6 +1746,7 @@ litest_setup_tests(void)
 	litest_add("pointer:accel", pointer_accel_profile_defaults_noprofile, LITEST_TOUCHPAD, LITEST_ANY);
 	litest_add("pointer:accel", pointer_accel_profile_invalid, LITEST_RELATIVE, LITEST_ANY);
 	litest_add("pointer:accel", pointer_accel_profile_flat_motion_relative, LITEST_RELATIVE, LITEST_TOUCHPAD);
+	litest_add("pointer:accel", pointer_accel_profile_custom, LITEST_RELATIVE, LITEST_TOUCHPAD);
 
 	litest_add("pointer:middlebutton", middlebutton, LITEST_BUTTON, LITEST_ANY);
 	litest_add("pointer:middlebutton", middlebutton_timeout, LITEST_BUTTON, LITEST_ANY);
@@ -1953,6 +1953,51 @@ START_TEST(serial_changes_tool)
 }
 END_TEST
 
+START_TEST(serial_many_tools)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_event_tablet_tool *tablet_event;
+	struct libinput_event *event;
+	struct libinput_tablet_tool *tools[64] = {0};
+	struct libinput_tablet_tool *tool;
+	int pass, i;
+
+	litest_drain_events(li);
+
+	/* enough tools to force the tool table to grow a few times, the
+	 * second pass must find the same tools again */
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < (int)ARRAY_LENGTH(tools); i++) {
+			litest_event(dev, EV_KEY, BTN_TOOL_PEN, 1);
+			litest_event(dev, EV_MSC, MSC_SERIAL, 1000 + i);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+			libinput_dispatch(li);
+
+			event = libinput_get_event(li);
+			tablet_event = litest_is_tablet_event(event,
+					LIBINPUT_EVENT_TABLET_TOOL_PROXIMITY);
+			tool = libinput_event_tablet_tool_get_tool(tablet_event);
+			ck_assert_uint_eq(libinput_tablet_tool_get_serial(tool),
+					  1000 + i);
+			libinput_event_destroy(event);
+
+			if (pass == 0)
+				tools[i] = libinput_tablet_tool_ref(tool);
+			else
+				ck_assert_ptr_eq(tool, tools[i]);
+
+			litest_event(dev, EV_KEY, BTN_TOOL_PEN, 0);
+			litest_event(dev, EV_SYN, SYN_REPORT, 0);
+			litest_drain_events(li);
+		}
+	}
+
+	for (i = 0; i < (int)ARRAY_LENGTH(tools); i++)
+		libinput_tablet_tool_unref(tools[i]);
+}
+END_TEST
+
 START_TEST(invalid_serials)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3530,6 +3575,40 @@ START_TEST(relative_delta)
 }
 END_TEST
 
+START_TEST(relative_filter_counter)
+{
+	struct litest_device *dev = litest_current_device();
+	struct libinput *li = dev->libinput;
+	struct libinput_device *device = dev->libinput_device;
+	struct axis_replacement axes[] = {
+		{ ABS_DISTANCE, 10 },
+		{ ABS_PRESSURE, 0 },
+		{ -1, -1 }
+	};
+	uint64_t filter;
+	int i;
+
+	litest_tablet_proximity_in(dev, 10, 10, axes);
+	litest_drain_events(li);
+
+	filter = libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH);
+
+	/* every relative delta goes through the filter */
+	for (i = 0; i < 5; i++)
+		litest_tablet_motion(dev, 20 + i * 5, 10, axes);
+	litest_drain_events(li);
+
+#if HAVE_COUNTERS
+	ck_assert_int_eq(libinput_device_get_counter(device,
+					LIBINPUT_DEVICE_COUNTER_FILTER_DISPATCH),
+			 filter + 5);
+#else
+	ck_assert_int_eq(filter, 0);
+#endif
+}
+END_TEST
+
 START_TEST(relative_calibration)
 {
 	struct litest_device *dev = litest_current_device();
@@ -3612,6 +3691,7 @@ litest_setup_tests(void)
 	litest_add("tablet:tool_serial", tool_unique, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", tool_serial, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", serial_changes_tool, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
+	litest_add("tablet:tool_serial", serial_many_tools, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add("tablet:tool_serial", invalid_serials, LITEST_TABLET | LITEST_TOOL_SERIAL, LITEST_ANY);
 	litest_add_no_device("tablet:tool_serial", tools_with_serials);
 	litest_add_no_device("tablet:tool_serial", tools_without_serials);
@@ -3676,5 +3756,6 @@ litest_setup_tests(void)
 	litest_add("tablet:relative", relative_no_profile, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:relative", relative_no_delta_prox_in, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:relative", relative_delta, LITEST_TABLET, LITEST_ANY);
+	litest_add("tablet:relative", relative_filter_counter, LITEST_TABLET, LITEST_ANY);
 	litest_add("tablet:relative", relative_calibration, LITEST_TABLET, LITEST_ANY);
 }
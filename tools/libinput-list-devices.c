@@ -187,9 +187,19 @@ click_defaults(struct libinput_device *device)
 static char*
 accel_profiles(struct libinput_device *device)
 {
+	static const struct {
+		enum libinput_config_accel_profile profile;
+		const char *name;
+	} names[] = {
+		{ LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT, "flat" },
+		{ LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE, "adaptive" },
+		{ LIBINPUT_CONFIG_ACCEL_PROFILE_CUSTOM, "custom" },
+	};
 	uint32_t profiles;
+	char buf[64] = "";
 	char *str;
 	enum libinput_config_accel_profile profile;
+	size_t i;
 
 	if (!libinput_device_config_accel_is_available(device)) {
 		xasprintf(&str, "n/a");
@@ -203,12 +213,20 @@ accel_profiles(struct libinput_device *device)
 	}
 
 	profile = libinput_device_config_accel_get_default_profile(device);
-	xasprintf(&str,
-		  "%s%s%s%s",
-		  (profile == LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT) ? "*" : "",
-		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_FLAT) ? "flat" : "",
-		  (profile == LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) ? "*" : "",
-		  (profiles & LIBINPUT_CONFIG_ACCEL_PROFILE_ADAPTIVE) ? "adaptive" : "");
+
+	/* only list the supported profiles, separated by a single space */
+	for (i = 0; i < ARRAY_LENGTH(names); i++) {
+		if ((profiles & names[i].profile) == 0)
+			continue;
+
+		if (buf[0] != '\0')
+			strcat(buf, " ");
+		if (names[i].profile == profile)
+			strcat(buf, "*");
+		strcat(buf, names[i].name);
+	}
+
+	xasprintf(&str, "%s", buf);
 
 	return str;
 }
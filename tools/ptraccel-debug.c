@@ -27,13 +27,23 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include <getopt.h>
+#include <inttypes.h>
+#include <math.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
 #include <unistd.h>
+#include <linux/perf_event.h>
 
 #include <filter.h>
 #include <libinput-util.h>
 
+/* maximum mean difference between the profile and the lookup table, see
+ * --mode=lut */
+#define LUT_MAX_MEAN_ERROR 0.0001
+
 static void
 print_ptraccel_deltas(struct motion_filter *filter, double step)
 {
@@ -111,9 +121,8 @@ print_ptraccel_sequence(struct motion_filter *filter,
 			int nevents,
 			double *deltas)
 {
-	struct normalized_coords motion;
-	uint64_t time = 0;
-	double *dx;
+	struct normalized_coords motion[1024];
+	uint64_t time[1024];
 	int i;
 
 	printf("# gnuplot:\n");
@@ -124,17 +133,16 @@ print_ptraccel_sequence(struct motion_filter *filter,
 	printf("#      \"gnuplot.data\" using 1:3 title \"dx in\"\n");
 	printf("#\n");
 
-	dx = deltas;
-
-	for (i = 0; i < nevents; i++, dx++) {
-		motion.x = *dx;
-		motion.y = 0;
-		time += us(12500); /* pretend 80Hz data */
+	for (i = 0; i < nevents; i++) {
+		motion[i].x = deltas[i];
+		motion[i].y = 0;
+		time[i] = us(12500) * (i + 1); /* pretend 80Hz data */
+	}
 
-		motion = filter_dispatch(filter, &motion, NULL, time);
+	filter_dispatch_batch(filter, motion, motion, time, nevents, NULL);
 
-		printf("%d	%.3f	%.3f\n", i, motion.x, *dx);
-	}
+	for (i = 0; i < nevents; i++)
+		printf("%d	%.3f	%.3f\n", i, motion[i].x, deltas[i]);
 }
 
 static void
@@ -153,17 +161,306 @@ print_accel_func(struct motion_filter *filter, accel_profile_func_t profile)
 	}
 }
 
+static int
+print_accel_lut_check(struct motion_filter *filter,
+		      accel_profile_func_t profile)
+{
+	double vel;
+	double max_error = 0.0,
+	       max_error_vel = 0.0,
+	       total_error = 0.0;
+	int nsamples = 0;
+
+	if (!pointer_accelerator_get_profile(filter)) {
+		fprintf(stderr, "Filter has no lookup table\n");
+		return 1;
+	}
+
+	printf("# gnuplot:\n");
+	printf("# set xlabel \"speed\"\n");
+	printf("# set ylabel \"accel factor\"\n");
+	printf("# set style data lines\n");
+	printf("# plot \"gnuplot.data\" using 1:2 title \"profile\", \\\n");
+	printf("#      \"gnuplot.data\" using 1:3 title \"lookup table\"\n");
+	printf("#\n");
+	for (vel = 0.0; vel < 0.006; vel += 0.0000001) {
+		double expected = profile(filter, NULL, vel, 0 /* time */);
+		double result, error;
+
+		pointer_accelerator_lookup_factor(filter, vel, &result);
+		error = fabs(expected - result);
+
+		if (error > max_error) {
+			max_error = error;
+			max_error_vel = vel;
+		}
+		total_error += error;
+		nsamples++;
+
+		printf("%.8f\t%.4f\t%.4f\t%.6f\n",
+		       vel, expected, result, error);
+	}
+
+	/* Where a profile is discontinuous, the interpolation within that
+	 * one table interval is off by up to the size of the step. Only
+	 * the mean error is a useful pass/fail criterion */
+	printf("# max error %.6f at speed %.8f\n", max_error, max_error_vel);
+	printf("# mean error %.6f\n", total_error/nsamples);
+
+	return total_error/nsamples > LUT_MAX_MEAN_ERROR ? 1 : 0;
+}
+
+static struct motion_filter *
+create_tablet_filter(int dpi)
+{
+	/* resolution in units/mm */
+	return create_pointer_accelerator_filter_tablet(dpi/25.4, dpi/25.4);
+}
+
+static struct motion_filter *
+create_custom_filter(int dpi)
+{
+	/* roughly the default adaptive profile */
+	static const double velocities[] = { 0.0, 0.4, 1.0, 3.0 };
+	static const double factors[] = { 0.5, 1.0, 1.7, 3.5 };
+
+	return create_pointer_accelerator_filter_custom(
+					dpi,
+					velocities,
+					factors,
+					ARRAY_LENGTH(velocities));
+}
+
+static const struct benchmark_filter {
+	const char *name;
+	struct motion_filter *(*create)(int dpi);
+} benchmark_filters[] = {
+	{ "flat", create_pointer_accelerator_filter_flat },
+	{ "linear", create_pointer_accelerator_filter_linear },
+	{ "low-dpi", create_pointer_accelerator_filter_linear_low_dpi },
+	{ "touchpad", create_pointer_accelerator_filter_touchpad },
+	{ "x230", create_pointer_accelerator_filter_lenovo_x230 },
+	{ "trackpoint", create_pointer_accelerator_filter_trackpoint },
+	{ "tablet", create_tablet_filter },
+	{ "custom", create_custom_filter },
+	{ "linear-fixed", create_pointer_accelerator_filter_linear_fixed },
+	{ "touchpad-fixed", create_pointer_accelerator_filter_touchpad_fixed },
+	{ "trackpoint-fixed", create_pointer_accelerator_filter_trackpoint_fixed },
+};
+
+/* Synthetic motion: strokes with a speed that ramps up from and back
+ * down to a fifth of the requested velocity, peaking at 1.8 times that
+ * velocity. The direction changes between strokes and curves slightly
+ * within a stroke. Deltas are integer device units, normalized to
+ * 1000dpi like evdev does. */
+static void
+benchmark_generate_motion(struct normalized_coords *deltas,
+			  uint64_t *times,
+			  int nevents,
+			  int dpi,
+			  int rate,
+			  double velocity,
+			  double turns)
+{
+	const double interval = 1000.0/rate; /* ms */
+	const double dpi_factor = 1000.0/dpi;
+	int stroke_length = max(1, (int)(rate / turns));
+	double angle = 0.0;
+	double speed, pos;
+	double remainder_x = 0.0, remainder_y = 0.0;
+	double dx, dy;
+	int i;
+
+	for (i = 0; i < nevents; i++) {
+		if (i % stroke_length == 0)
+			angle += 2.4; /* radians */
+		else
+			angle += 0.002;
+
+		/* 0 → 1 → 0 over the stroke */
+		pos = (double)(i % stroke_length) / stroke_length;
+		pos = 1.0 - fabs(2.0 * pos - 1.0);
+		speed = velocity * (0.2 + 1.6 * pos); /* units/ms */
+
+		/* device units */
+		dx = speed * interval * cos(angle) / dpi_factor + remainder_x;
+		dy = speed * interval * sin(angle) / dpi_factor + remainder_y;
+		remainder_x = dx - round(dx);
+		remainder_y = dy - round(dy);
+
+		deltas[i].x = round(dx) * dpi_factor;
+		deltas[i].y = round(dy) * dpi_factor;
+		times[i] = ms2us(1000) + (uint64_t)(i * interval * 1000.0);
+	}
+}
+
+static int
+open_cache_miss_counter(void)
+{
+	struct perf_event_attr attr;
+
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_CACHE_MISSES;
+	attr.disabled = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+
+	return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+
+/* FNV-1a over the accelerated deltas, any change in the output changes
+ * the checksum */
+static uint64_t
+benchmark_checksum(const struct normalized_coords *motion, int nevents)
+{
+	const unsigned char *bytes = (const unsigned char *)motion;
+	size_t len = nevents * sizeof(*motion);
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for (i = 0; i < len; i++) {
+		hash ^= bytes[i];
+		hash *= 0x100000001b3ULL;
+	}
+
+	return hash;
+}
+
+static int
+run_benchmark(int nevents,
+	      int dpi,
+	      double speed,
+	      int rate,
+	      double velocity,
+	      double turns)
+{
+	struct normalized_coords *deltas, *motion;
+	uint64_t *times;
+	struct timespec start, end;
+	uint64_t ns, misses;
+	unsigned int f;
+	int i;
+	int counter;
+
+	if (nevents == 0)
+		nevents = 1000000;
+
+	deltas = zalloc(nevents * sizeof(*deltas));
+	motion = zalloc(nevents * sizeof(*motion));
+	times = zalloc(nevents * sizeof(*times));
+	if (!deltas || !motion || !times) {
+		fprintf(stderr, "Failed to allocate %d events\n", nevents);
+		free(deltas);
+		free(motion);
+		free(times);
+		return 1;
+	}
+
+	benchmark_generate_motion(deltas, times, nevents,
+				  dpi, rate, velocity, turns);
+
+	counter = open_cache_miss_counter();
+
+	printf("# %d events at %dHz, %.2f units/ms, %.1f direction changes/s\n",
+	       nevents, rate, velocity, turns);
+	if (counter < 0)
+		printf("# cache misses not available: %s\n", strerror(errno));
+	printf("# %-16s\t%s\t%s\t%s\n",
+	       "filter", "ns/event", "misses/event", "checksum");
+
+	for (f = 0; f < ARRAY_LENGTH(benchmark_filters); f++) {
+		const struct benchmark_filter *b = &benchmark_filters[f];
+		struct motion_filter *filter;
+
+		filter = b->create(dpi);
+		assert(filter != NULL);
+		filter_set_speed(filter, speed);
+
+		if (counter >= 0) {
+			ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+			ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		/* same as evdev_filter_dispatch() */
+		switch (filter_get_dispatch_type(filter)) {
+		case FILTER_DISPATCH_LINEAR:
+			for (i = 0; i < nevents; i++)
+				motion[i] = filter_dispatch_linear(filter,
+								   &deltas[i],
+								   NULL,
+								   times[i]);
+			break;
+		case FILTER_DISPATCH_TOUCHPAD:
+			for (i = 0; i < nevents; i++)
+				motion[i] = filter_dispatch_touchpad(filter,
+								     &deltas[i],
+								     NULL,
+								     times[i]);
+			break;
+		case FILTER_DISPATCH_GENERIC:
+			for (i = 0; i < nevents; i++)
+				motion[i] = filter_dispatch(filter,
+							    &deltas[i],
+							    NULL,
+							    times[i]);
+			break;
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		if (counter >= 0) {
+			ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+			if (read(counter, &misses, sizeof(misses)) !=
+			    sizeof(misses))
+				misses = 0;
+		}
+
+		ns = (end.tv_sec - start.tv_sec) * 1000000000ULL +
+		     end.tv_nsec - start.tv_nsec;
+
+		printf("%-18s\t%8.1f\t", b->name, (double)ns/nevents);
+		if (counter >= 0)
+			printf("%12.4f", (double)misses/nevents);
+		else
+			printf("%12s", "n/a");
+		printf("\t%016" PRIx64 "\n", benchmark_checksum(motion, nevents));
+
+		filter_destroy(filter);
+	}
+
+	if (counter >= 0)
+		close(counter);
+
+	free(deltas);
+	free(motion);
+	free(times);
+
+	return 0;
+}
+
 static void
 usage(void)
 {
 	printf("Usage: %s [options] [dx1] [dx2] [...] > gnuplot.data\n", program_invocation_short_name);
 	printf("\n"
 	       "Options:\n"
-	       "--mode=<motion|accel|delta|sequence> \n"
+	       "--mode=<motion|accel|delta|sequence|lut|benchmark> \n"
 	       "	motion   ... print motion to accelerated motion (default)\n"
 	       "	delta    ... print delta to accelerated delta\n"
 	       "	accel    ... print accel factor\n"
 	       "	sequence ... print motion for custom delta sequence\n"
+	       "	lut      ... print accel factor from the profile and the lookup table,\n"
+	       "	             fails if the mean difference exceeds 0.0001\n"
+	       "	benchmark... run synthetic motion through all filters, print\n"
+	       "	             ns/event, cache misses/event and a checksum of the output\n"
+	       "--nevents=<int>  ... in motion and benchmark modes only. Number of events\n"
+	       "--rate=<int>     ... in benchmark mode only. Report rate in Hz (default: 1000)\n"
+	       "--velocity=<double> ... in benchmark mode only. Average pointer velocity\n"
+	       "	             in units/ms (default: 1.0)\n"
+	       "--turns=<double> ... in benchmark mode only. Direction changes per second\n"
+	       "	             (default: 2.0)\n"
 	       "--maxdx=<double>  ... in motion mode only. Stop increasing dx at maxdx\n"
 	       "--steps=<double>  ... in motion and delta modes only. Increase dx by step each round\n"
 	       "--speed=<double>  ... accel speed [-1, 1], default 0\n"
@@ -194,12 +491,18 @@ main(int argc, char **argv)
 	bool print_accel = false,
 	     print_motion = true,
 	     print_delta = false,
-	     print_sequence = false;
+	     print_sequence = false,
+	     print_lut = false,
+	     benchmark = false;
 	double custom_deltas[1024];
 	double speed = 0.0;
 	int dpi = 1000;
+	int rate = 1000;
+	double velocity = 1.0,
+	       turns = 2.0;
 	const char *filter_type = "linear";
 	accel_profile_func_t profile = NULL;
+	int rc = 0;
 
 	enum {
 		OPT_MODE = 1,
@@ -209,6 +512,9 @@ main(int argc, char **argv)
 		OPT_SPEED,
 		OPT_DPI,
 		OPT_FILTER,
+		OPT_RATE,
+		OPT_VELOCITY,
+		OPT_TURNS,
 	};
 
 	while (1) {
@@ -222,6 +528,9 @@ main(int argc, char **argv)
 			{"speed", 1, 0, OPT_SPEED },
 			{"dpi", 1, 0, OPT_DPI },
 			{"filter", 1, 0, OPT_FILTER},
+			{"rate", 1, 0, OPT_RATE },
+			{"velocity", 1, 0, OPT_VELOCITY },
+			{"turns", 1, 0, OPT_TURNS },
 			{0, 0, 0, 0}
 		};
 
@@ -240,6 +549,10 @@ main(int argc, char **argv)
 				print_delta = true;
 			else if (streq(optarg, "sequence"))
 				print_sequence = true;
+			else if (streq(optarg, "lut"))
+				print_lut = true;
+			else if (streq(optarg, "benchmark"))
+				benchmark = true;
 			else {
 				usage();
 				return 1;
@@ -275,6 +588,27 @@ main(int argc, char **argv)
 		case OPT_FILTER:
 			filter_type = optarg;
 			break;
+		case OPT_RATE:
+			rate = atoi(optarg);
+			if (rate <= 0) {
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_VELOCITY:
+			velocity = strtod(optarg, NULL);
+			if (velocity <= 0.0) {
+				usage();
+				return 1;
+			}
+			break;
+		case OPT_TURNS:
+			turns = strtod(optarg, NULL);
+			if (turns <= 0.0) {
+				usage();
+				return 1;
+			}
+			break;
 		default:
 			usage();
 			exit(1);
@@ -282,6 +616,10 @@ main(int argc, char **argv)
 		}
 	}
 
+	/* the benchmark runs all filters */
+	if (benchmark)
+		return run_benchmark(nevents, dpi, speed, rate, velocity, turns);
+
 	if (streq(filter_type, "linear")) {
 		filter = create_pointer_accelerator_filter_linear(dpi);
 		profile = pointer_accel_profile_linear;
@@ -324,7 +662,9 @@ main(int argc, char **argv)
 			custom_deltas[nevents++] = strtod(argv[optind++], NULL);
 	}
 
-	if (print_accel)
+	if (print_lut)
+		rc = print_accel_lut_check(filter, profile);
+	else if (print_accel)
 		print_accel_func(filter, profile);
 	else if (print_delta)
 		print_ptraccel_deltas(filter, step);
@@ -335,5 +675,5 @@ main(int argc, char **argv)
 
 	filter_destroy(filter);
 
-	return 0;
+	return rc;
 }